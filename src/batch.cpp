@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+#include "batch.h"
+#include "common/arena.h"
+#include "common/diagnostics.h"
+#include "common/logging.h"
+#include "common/parallel.h"
+#include "common/wildcard.h"
+#include "tours.h"
+
+namespace fs = std::filesystem;
+
+namespace Evo {
+
+static std::vector<fs::path> CollectInputs(const std::string& input) {
+    std::vector<fs::path> inputs;
+    if (input.starts_with('@')) {
+        const fs::path manifest = input.substr(1);
+        std::ifstream is(manifest);
+        if (!is) {
+            LOG_ERROR("Could not open manifest \"{}\"", manifest.string());
+            return inputs;
+        }
+        std::string line;
+        while (std::getline(is, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty() || line.starts_with('#')) {
+                continue;
+            }
+            const fs::path path = line;
+            inputs.push_back(path.is_relative() ? manifest.parent_path() / path : path);
+        }
+    } else if (fs::is_directory(input)) {
+        for (const auto& entry : fs::directory_iterator(input)) {
+            if (entry.is_regular_file()) {
+                inputs.push_back(entry.path());
+            }
+        }
+    } else {
+        const fs::path pattern = input;
+        const fs::path dir = pattern.has_parent_path() ? pattern.parent_path() : fs::path(".");
+        const std::string name_pattern = pattern.filename().string();
+        if (fs::is_directory(dir)) {
+            for (const auto& entry : fs::directory_iterator(dir)) {
+                if (entry.is_regular_file() && Common::WildcardMatch(name_pattern, entry.path().filename().string())) {
+                    inputs.push_back(entry.path());
+                }
+            }
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+size_t RunBatch(const std::string& input, const std::string& output_dir) {
+    const std::vector<fs::path> inputs = CollectInputs(input);
+    if (inputs.empty()) {
+        LOG_ERROR("No input files found for \"{}\"", input);
+        return 1;
+    }
+    fs::create_directories(output_dir);
+
+    struct WorkerBuffers {
+        std::vector<char> binary;
+        std::string json;
+        // Holds each file and its records, reset between files so the memory is reused
+        Common::Arena arena;
+    };
+    // Each worker converts one file at a time; a parallel decode or encode within it only gets the cores left over
+    const size_t worker_count = std::min(Common::AvailableWorkers(), inputs.size());
+    std::vector<WorkerBuffers> buffers(worker_count);
+    std::atomic<u64> bytes_in{0}, bytes_out{0};
+    std::atomic<size_t> failed_files{0};
+    // One line per problem; a file that fails to load can contribute several
+    std::mutex failures_mutex;
+    std::vector<std::string> failures, warnings;
+
+    const auto start = std::chrono::steady_clock::now();
+    Common::ParallelFor(
+        inputs.size(),
+        [&](size_t i, size_t worker) {
+            const fs::path& in = inputs[i];
+            if (!fs::is_regular_file(in)) {
+                failed_files++;
+                std::scoped_lock lock{failures_mutex};
+                failures.push_back(fmt::format("{}: does not exist or is not a file", in.string()));
+                return;
+            }
+            try {
+                const bool to_json = DcTour::IsBinaryFile(in.string());
+                fs::path out = fs::path(output_dir) / in.filename();
+                if (to_json) {
+                    out += ".json";
+                } else if (out.extension() == ".json") {
+                    out.replace_extension();
+                } else {
+                    out += ".tour";
+                }
+
+                // The previous file's tour is gone by now, so its memory can be reused
+                buffers[worker].arena.Reset();
+                DcTour tour(&buffers[worker].arena);
+                Common::Diagnostics diagnostics;
+                const bool loaded = to_json ? tour.LoadBinaryFile(in.string(), diagnostics)
+                                            : tour.LoadJsonFile(in.string(), diagnostics);
+                if (!diagnostics.Entries().empty()) {
+                    std::scoped_lock lock{failures_mutex};
+                    for (const Common::Diagnostic& d : diagnostics.Entries()) {
+                        (d.severity == Common::Severity::Warning ? warnings : failures)
+                            .push_back(fmt::format("{}: {}", in.string(), d.ToString()));
+                    }
+                }
+                if (!loaded) {
+                    failed_files++;
+                    return;
+                }
+                // A failed save throws after removing what it wrote, so the file only counts as failed below
+                if (to_json) {
+                    tour.SaveJsonFile(out.string(), buffers[worker].json);
+                } else {
+                    tour.SaveBinaryFile(out.string(), buffers[worker].binary);
+                }
+                bytes_in += fs::file_size(in);
+                bytes_out += fs::file_size(out);
+            } catch (const std::exception& e) {
+                failed_files++;
+                std::scoped_lock lock{failures_mutex};
+                failures.push_back(fmt::format("{}: {}", in.string(), e.what()));
+            }
+        },
+        worker_count);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double mb_in = bytes_in / double(1_MB), mb_out = bytes_out / double(1_MB);
+    LOG_INFO("Converted {} of {} files on {} threads in {:.2f}s: {:.1f} MB read, {:.1f} MB written, {:.1f} MB/s",
+             inputs.size() - failed_files, inputs.size(), worker_count, seconds, mb_in, mb_out,
+             seconds > 0 ? (mb_in + mb_out) / seconds : 0.0);
+    for (const std::string& warning : warnings) {
+        LOG_WARNING("{}", warning);
+    }
+    for (const std::string& failure : failures) {
+        LOG_ERROR("Failed: {}", failure);
+    }
+    return failed_files;
+}
+
+} // namespace Evo
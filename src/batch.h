@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+
+namespace Evo {
+
+// Converts every dc.tour file named by `input` (a directory, a glob such as "mods/*.tour", or "@manifest.txt" listing
+// one path per line) into `output_dir`, on all cores. Binary files become "<name>.json", JSON files are converted
+// back to binary with the ".json" suffix removed. Returns the number of files that failed.
+size_t RunBatch(const std::string& input, const std::string& output_dir);
+
+} // namespace Evo
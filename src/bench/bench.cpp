@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "bench/generator.h"
+#include "common/arena.h"
+#include "common/json_writer.h"
+#include "common/logging.h"
+#include "common/types.h"
+#include "event_dedup.h"
+#include "event_table.h"
+#include "tours.h"
+
+namespace fs = std::filesystem;
+
+// Every allocation in the process goes through these, so each phase can report how many it made and how much heap
+// it needed at most. The size is stashed in front of the block because unsized delete does not provide it. The
+// aligned overloads matter too: std::pmr containers allocate through them.
+namespace {
+std::atomic<u64> allocation_count{0};
+std::atomic<s64> live_bytes{0};
+std::atomic<s64> peak_live_bytes{0};
+constexpr size_t AllocationHeader = alignof(std::max_align_t);
+
+void* CountedAlloc(size_t size, size_t alignment = AllocationHeader) {
+    // The header is a whole alignment unit so the block handed out keeps the requested alignment
+    const size_t header = std::max(alignment, AllocationHeader);
+#ifdef _WIN32
+    void* block = alignment > AllocationHeader ? _aligned_malloc(size + header, alignment) : std::malloc(size + header);
+#else
+    void* block = alignment > AllocationHeader
+                      ? std::aligned_alloc(alignment, (size + header + alignment - 1) / alignment * alignment)
+                      : std::malloc(size + header);
+#endif
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    const s64 live = live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    s64 peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + header;
+}
+
+void CountedFree(void* ptr, size_t alignment = AllocationHeader) {
+    if (!ptr) {
+        return;
+    }
+    void* block = static_cast<char*>(ptr) - std::max(alignment, AllocationHeader);
+    live_bytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+#ifdef _WIN32
+    if (alignment > AllocationHeader) {
+        _aligned_free(block);
+        return;
+    }
+#endif
+    std::free(block);
+}
+} // namespace
+
+void* operator new(size_t size) {
+    return CountedAlloc(size);
+}
+void* operator new[](size_t size) {
+    return CountedAlloc(size);
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return CountedAlloc(size, static_cast<size_t>(alignment));
+}
+void operator delete(void* ptr) noexcept {
+    CountedFree(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    CountedFree(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    CountedFree(ptr);
+}
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+void operator delete(void* ptr, size_t, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+void operator delete[](void* ptr, size_t, std::align_val_t alignment) noexcept {
+    CountedFree(ptr, static_cast<size_t>(alignment));
+}
+
+static u64 PeakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return static_cast<u64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+// Writes t like `w << t`, but with the keys of every record in reverse field order, so that reading it back can never
+// predict the next key and has to look each one up.
+template <typename T>
+static void WriteKeysReversed(Common::JsonWriter& w, const T& t) {
+    if constexpr (Evo::Record<T>) {
+        w.BeginObject();
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            constexpr size_t last = sizeof...(I) - 1;
+            ((w.Key(std::get<last - I>(Evo::Fields<T>::value).name),
+              WriteKeysReversed(w, t.*std::get<last - I>(Evo::Fields<T>::value).member)),
+             ...);
+        }(std::make_index_sequence<Evo::FieldCount<T>>{});
+        w.EndObject();
+    } else if constexpr (Evo::IsArray<T>) {
+        w.BeginObject();
+        w.Key("name") << t.name;
+        w.Key("data").BeginArray();
+        for (const auto& item : t.data) {
+            WriteKeysReversed(w, item);
+        }
+        w.EndArray();
+        w.EndObject();
+    } else if constexpr (Evo::IsFixedArray<T>) {
+        w.BeginArray();
+        for (const auto& item : t.data) {
+            WriteKeysReversed(w, item);
+        }
+        w.EndArray();
+    } else {
+        w << t;
+    }
+}
+
+struct PhaseResult {
+    double best_seconds = 1e30;
+    double total_seconds = 0;
+    u64 allocations = 0;
+    s64 peak_heap = 0;
+};
+
+// Runs fn `iterations` times and keeps the best time plus the allocation figures of the last run.
+template <typename F>
+static void RunPhase(std::string_view name, u64 bytes, s32 iterations, F&& fn) {
+    PhaseResult result;
+    for (s32 i = 0; i < iterations; i++) {
+        const u64 allocations_before = allocation_count.load();
+        peak_live_bytes.store(live_bytes.load());
+        const s64 live_before = live_bytes.load();
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.best_seconds = std::min(result.best_seconds, seconds);
+        result.total_seconds += seconds;
+        result.allocations = allocation_count.load() - allocations_before;
+        result.peak_heap = peak_live_bytes.load() - live_before;
+    }
+    fmt::println("{:<22} {:>9.2f} ms {:>9.2f} ms {:>9.1f} MB/s {:>11} allocs {:>9.1f} MB heap {:>9.1f} MB rss", name,
+                 result.best_seconds * 1000, result.total_seconds * 1000 / iterations,
+                 bytes / double(1_MB) / result.best_seconds, result.allocations,
+                 result.peak_heap / double(1_MB), PeakRssBytes() / double(1_MB));
+}
+
+static void PrintUsage() {
+    fmt::println("dc-tour-bench [options]");
+    fmt::println("  --events <n>           Number of events to generate (default 10000)");
+    fmt::println("  --drivers <n>          Number of drivers to generate (default 500)");
+    fmt::println("  --vehicle-classes <n>  Number of vehicle classes to generate (default 50)");
+    fmt::println("  --iterations <n>       Runs per phase, the best one is reported (default 5)");
+    fmt::println("  --dir <path>           Where to put the generated files (default: system temp directory)");
+}
+
+int main(int argc, char** argv) {
+    Bench::GeneratorConfig config;
+    s32 iterations = 5;
+    fs::path dir = fs::temp_directory_path();
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--events") {
+            config.events = std::stoi(value);
+        } else if (arg == "--drivers") {
+            config.drivers = std::stoi(value);
+        } else if (arg == "--vehicle-classes") {
+            config.vehicle_classes = std::stoi(value);
+        } else if (arg == "--iterations") {
+            iterations = std::max(1, std::stoi(value));
+        } else if (arg == "--dir") {
+            dir = value;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const std::string binary_path = (dir / "dc-tour-bench.tour").string();
+    const std::string json_path = (dir / "dc-tour-bench.json").string();
+    const std::string reversed_path = (dir / "dc-tour-bench-reversed.json").string();
+    const std::string scratch_path = (dir / "dc-tour-bench.out").string();
+    {
+        Evo::DcTour tour = Bench::GenerateTour(config);
+        tour.SaveBinaryFile(binary_path);
+        tour.SaveJsonFile(json_path);
+        std::ofstream ofs(reversed_path, std::ios::binary);
+        Common::JsonWriter w(&ofs);
+        WriteKeysReversed(w, tour);
+        w.Finish();
+    }
+    const u64 binary_size = fs::file_size(binary_path);
+    const u64 json_size = fs::file_size(json_path);
+    const u64 reversed_size = fs::file_size(reversed_path);
+    fmt::println("{} events, {} drivers, {} vehicle classes: {:.1f} MB binary, {:.1f} MB json", config.events,
+                 config.drivers, config.vehicle_classes, binary_size / double(1_MB), json_size / double(1_MB));
+    fmt::println("{:<22} {:>12} {:>12} {:>14} {:>18} {:>17} {:>16}", "phase", "best", "mean", "throughput",
+                 "allocations", "peak heap", "peak rss");
+
+    Evo::DcTour loaded;
+    loaded.LoadBinaryFile(binary_path);
+    loaded.InternStrings();
+    RunPhase("LoadBinaryFile", binary_size, iterations, [&] {
+        Evo::DcTour tour;
+        tour.LoadBinaryFile(binary_path);
+    });
+    // What a long-lived consumer pays on top of the load
+    RunPhase("LoadBinaryFile intern", binary_size, iterations, [&] {
+        Evo::DcTour tour;
+        tour.LoadBinaryFile(binary_path);
+        tour.InternStrings();
+    });
+    RunPhase("SaveBinaryFile", binary_size, iterations, [&] { loaded.SaveBinaryFile(scratch_path); });
+    RunPhase("LoadJsonFile", json_size, iterations, [&] {
+        Evo::DcTour tour;
+        tour.LoadJsonFile(json_path);
+    });
+    // Steady state of batch mode, where each worker loads file after file into the same arena
+    Common::Arena arena;
+    RunPhase("LoadBinaryFile arena", binary_size, iterations, [&] {
+        arena.Reset();
+        Evo::DcTour tour(&arena);
+        tour.LoadBinaryFile(binary_path);
+    });
+    RunPhase("LoadJsonFile arena", json_size, iterations, [&] {
+        arena.Reset();
+        Evo::DcTour tour(&arena);
+        tour.LoadJsonFile(json_path);
+    });
+    // Same document with every key out of order, which measures the field lookup rather than the order prediction
+    RunPhase("LoadJsonFile reordered", reversed_size, iterations, [&] {
+        Evo::DcTour tour;
+        tour.LoadJsonFile(reversed_path);
+    });
+    RunPhase("SaveJsonFile", json_size, iterations, [&] { loaded.SaveJsonFile(scratch_path); });
+    RunPhase("-jj round trip", json_size * 2, iterations, [&] {
+        Evo::DcTour tour;
+        tour.LoadJsonFile(json_path);
+        tour.SaveJsonFile(scratch_path);
+    });
+    // Hash-consed events, and hashing every event through the block ids against hashing the full records
+    const u64 events_size = Evo::BinarySize(loaded.events);
+    RunPhase("DedupedEvents build", events_size, iterations, [&] { Evo::DedupedEvents deduped(loaded); });
+    const Evo::DedupedEvents deduped(loaded);
+    RunPhase("DedupedEvents restore", events_size, iterations, [&] {
+        Evo::DcTour tour;
+        deduped.Restore(tour);
+    });
+    u64 hash_sink = 0;
+    RunPhase("hash events", events_size, iterations, [&] {
+        for (const Evo::Event& event : loaded.events.data) {
+            hash_sink += Evo::HashValue(event);
+        }
+    });
+    RunPhase("hash events deduped", events_size, iterations, [&] {
+        for (size_t i = 0; i < deduped.Size(); i++) {
+            hash_sink += deduped.Hash(i);
+        }
+    });
+    // "Events on one track with difficulty above 3", over the event records and over the columns
+    const std::string_view track = loaded.events.data.empty() ? "" : loaded.events.data[0].track.view();
+    u64 match_sink = 0;
+    RunPhase("scan events", events_size, iterations, [&] {
+        for (const Evo::Event& event : loaded.events.data) {
+            match_sink += event.track.view() == track && event.difficulty.data > 3;
+        }
+    });
+    RunPhase("EventTable build", events_size, iterations, [&] { Evo::EventTable table(loaded.events); });
+    const Evo::EventTable table(loaded.events);
+    RunPhase("EventTable scan", events_size, iterations, [&] {
+        Evo::RowSet rows = table.All();
+        table.Filter(rows, table.ColumnIndex("track"), Evo::Compare::Equal, track);
+        table.Filter(rows, table.ColumnIndex("difficulty"), Evo::Compare::Greater, 3);
+        match_sink += rows.Count();
+    });
+    fmt::println("{} events share {} distinct blocks, {:.1f} MB deduplicated (hash {:x})", deduped.Size(),
+                 deduped.UniqueBlocks(), deduped.MemoryBytes() / double(1_MB), (hash_sink ^ match_sink) & 0xF);
+
+    // HexString codec on growing blobs: every size processes the same number of bytes in total, so equal
+    // throughput across the rows means the cost is linear in the length
+    constexpr u64 HexBytesPerRun = 16_MB;
+    for (const u64 size : {16_KB / 256, 4_KB, 256_KB, 16_MB}) {
+        Evo::HexString blob;
+        char* bytes = blob.Reset(size);
+        for (u64 i = 0; i < size; i++) {
+            bytes[i] = static_cast<char>(i * 131 + 7);
+        }
+        const std::string hex = blob.hex_str();
+        const u64 runs = HexBytesPerRun / size;
+        RunPhase(fmt::format("hex encode {:>8} B", size), HexBytesPerRun, iterations, [&] {
+            for (u64 i = 0; i < runs; i++) {
+                std::string encoded = blob.hex_str();
+            }
+        });
+        RunPhase(fmt::format("hex decode {:>8} B", size), HexBytesPerRun, iterations, [&] {
+            Evo::HexString decoded;
+            for (u64 i = 0; i < runs; i++) {
+                decoded.AssignHex(hex);
+            }
+        });
+    }
+
+    fs::remove(binary_path);
+    fs::remove(json_path);
+    fs::remove(reversed_path);
+    fs::remove(scratch_path);
+    return 0;
+}
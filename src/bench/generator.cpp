@@ -0,0 +1,175 @@
+#include <random>
+
+#include "bench/generator.h"
+
+namespace Bench {
+
+using namespace Evo;
+
+static Integer MakeInteger(s32 value) {
+    return Integer{value};
+}
+
+static Float MakeFloat(f32 value) {
+    Float f;
+    f.data = value;
+    return f;
+}
+
+static Boolean MakeBoolean(bool value) {
+    Boolean b;
+    b.data = value ? 1 : 0;
+    return b;
+}
+
+template <typename T, typename F>
+static void Fill(Array<T>& array, std::string_view name, s32 count, F&& fill) {
+    array.name.Assign(name);
+    array.size = MakeInteger(count);
+    array.data.resize(count);
+    for (s32 i = 0; i < count; i++) {
+        fill(array.data[i], i);
+    }
+}
+
+DcTour GenerateTour(const GeneratorConfig& config) {
+    static constexpr std::string_view tracks[] = {"Norway_Ovre_Eidfjord", "Norway_Tyssedal", "India_Kodaikanal",
+                                                  "Chile_Atacama", "Canada_Bonnet_Plume", "Scotland_Loch_Rannoch",
+                                                  "Japan_Hakone", "Chile_Ojos_del_Salado"};
+    static constexpr std::string_view weathers[] = {"clear", "cloudy", "overcast", "storm", "fog"};
+    static constexpr std::string_view precipitations[] = {"none", "rain", "snow"};
+    static constexpr std::string_view event_types[] = {"RACE", "TIME_TRIAL", "DRIFT", "FACE_OFF"};
+    static constexpr std::string_view countries[] = {"GB", "DE", "FR", "IT", "JP", "US", "SE", "NO", "IN", "CL"};
+
+    std::mt19937 rng(config.seed);
+    const auto pick = [&rng](s32 count) { return static_cast<s32>(rng() % static_cast<u32>(count)); };
+    const s32 tour_count = std::max(1, config.events / 200);
+    const s32 unlock_group_count = std::max(1, config.events / 20);
+    const s32 ghost_count = std::max(1, config.drivers / 10);
+    const s32 driver_count = std::max(1, config.drivers);
+
+    DcTour tour;
+    tour.tourdata_str.Assign("TOURDATA");
+    tour.version = MakeInteger(44);
+    Fill(tour.tours, "tours", tour_count, [&](Tour& t, s32 i) {
+        t.id = MakeInteger(i);
+        t.lams_id.Assign(fmt::format("TOUR_{}_NAME", i));
+        t.unk3 = t.lams_id;
+        t.menu_texture.Assign(fmt::format("tour_banner_{}", i));
+        t.texture_tile_set = MakeInteger(i % 8);
+        t.is_tour_active = MakeInteger(1);
+        t.unk8 = MakeInteger(0);
+        t.completed_texture.Assign(fmt::format("tour_complete_{}", i));
+        t.license_type = MakeInteger(2 + i % 2);
+        t.included_in_collection = MakeInteger(0);
+    });
+    Fill(tour.objectives, "objectives", 32, [&](Objective& o, s32 i) {
+        o.id = MakeInteger(i);
+        o.objective_str.Assign(fmt::format("OBJECTIVE_{}", i));
+        o.operator_type.Assign(i % 2 ? "GREATER" : "LESS");
+        o.lams_id.Assign(fmt::format("OBJECTIVE_{}_LAMS", i));
+        o.unk3 = o.lams_id;
+    });
+    Fill(tour.faceoffs, "faceoffs", ghost_count, [&](FaceOff& f, s32 i) {
+        f.id = MakeInteger(i);
+        f.ghost.Assign(fmt::format("ghost_{}", i));
+        f.opponent_name.Assign(fmt::format("Opponent {}", i));
+    });
+    Fill(tour.unlock_groups, "unlock_groups", unlock_group_count, [&](UnlockGroup& g, s32 i) {
+        g.id = MakeInteger(i);
+        g.tour_id = MakeInteger(i % tour_count);
+        g.menu_layout = MakeInteger(1 + i % 10);
+        g.stars_to_unlock = MakeInteger(i * 3);
+        g.is_championship = MakeBoolean(i % 5 == 0);
+        g.championship_texture.Assign(i % 5 == 0 ? "championship_banner" : "");
+        g.lams_id.Assign(fmt::format("UNLOCK_GROUP_{}", i));
+        g.unk8 = g.lams_id;
+    });
+    Fill(tour.drivers, "drivers", driver_count, [&](Driver& d, s32 i) {
+        d.id = MakeInteger(i);
+        d.unk2 = MakeBoolean(false);
+        d.name.Assign(fmt::format("DRIVER_{}_NAME", i));
+        d.country.Assign(countries[pick(std::size(countries))]);
+        d.pronoun.Assign(i % 2 ? "he" : "she");
+        d.race.Assign("default");
+        d.head_type = MakeInteger(pick(20));
+        d.body_type = MakeInteger(pick(8));
+        d.difficulty.Assign(i % 3 ? "normal" : "hard");
+        d.team.Assign(fmt::format("team_{}", i % 16));
+        d.color_rgba = MakeInteger(static_cast<s32>(rng()));
+        d.livery.Assign(fmt::format("livery_{}", i % 64));
+    });
+    Fill(tour.ghosts, "ghosts", ghost_count, [&](Ghost& g, s32 i) {
+        g.id = MakeInteger(i);
+        g.name.Assign(fmt::format("ghost_{}", i));
+        g.livery.Assign(fmt::format("livery_{}", i % 64));
+    });
+    Fill(tour.vehicle_classes, "vehicle_classes", config.vehicle_classes, [&](VehicleClass& v, s32 i) {
+        v.id.Assign(fmt::format("g{}", i));
+        v.name.Assign(fmt::format("VEHICLE_CLASS_{}", i));
+        for (s32 k = 0; k < 50; k++) {
+            v.vehicle_ids[k] = MakeInteger(k < 20 ? i * 50 + k : -1);
+        }
+    });
+    Fill(tour.events, "events", config.events, [&](Event& e, s32 i) {
+        const s32 group = i % unlock_group_count;
+        e.position_in_championship = MakeInteger(i % 4);
+        e.race_id = MakeInteger(i);
+        e.event_id = MakeInteger(1000 + i);
+        e.unk4 = MakeBoolean(true);
+        e.trophy_id = MakeInteger(-1);
+        e.tour_menu_lams_id.Assign(fmt::format("EVENT_{}_MENU", i));
+        e.gameplay_menu_lams_id.Assign(fmt::format("EVENT_{}_GAMEPLAY", i));
+        e.unlock_group = MakeInteger(group);
+        e.group_position = MakeInteger(i / unlock_group_count);
+        e.type_texture.Assign("event_type_race");
+        e.texture_small.Assign(fmt::format("event_small_{}", i % 32));
+        e.texture_small_position = MakeInteger(pick(4));
+        e.texture_large.Assign(fmt::format("event_large_{}", i % 32));
+        e.fame_per_star_earned = MakeInteger(100 * (1 + pick(5)));
+        e.trophy_completed = MakeInteger(0);
+        e.track.Assign(tracks[pick(std::size(tracks))]);
+        e.time_of_day = MakeFloat(static_cast<f32>(pick(24 * 4)) / 4.0f);
+        e.speed_of_time = MakeFloat(1.0f + static_cast<f32>(pick(4)));
+        e.weather.Assign(weathers[pick(std::size(weathers))]);
+        e.precipitation.Assign(precipitations[pick(std::size(precipitations))]);
+        e.precipitation_time_scalar = MakeFloat(static_cast<f32>(pick(100)) / 100.0f);
+        e.difficulty = MakeInteger(1 + pick(5));
+        e.number_of_laps = MakeInteger(1 + pick(5));
+        e.type.Assign(event_types[pick(std::size(event_types))]);
+        for (s32 k = 0; k < 5; k++) {
+            EventObjective& o = e.objectives[k];
+            o.gold_objective_type = MakeInteger(pick(32));
+            o.gold_objective_target_int = MakeInteger(pick(1000));
+            o.silver_objective_type = MakeInteger(pick(32));
+            o.silver_objective_target_int = MakeInteger(pick(1000));
+        }
+        for (s32 k = 0; k < 3; k++) {
+            EventObjective& o = e.extra_star_requirements[k];
+            o.gold_objective_type = MakeInteger(k == 0 ? pick(32) : -1);
+            o.gold_objective_target_int = MakeInteger(k == 0 ? pick(100) : -1);
+            o.silver_objective_type = MakeInteger(-1);
+            o.silver_objective_target_int = MakeInteger(-1);
+        }
+        const s32 player_slot = pick(12);
+        for (s32 k = 0; k < 12; k++) {
+            AiGridDefinition& grid = e.ai_grid_definitions[k];
+            const bool player = k == player_slot;
+            grid.driver_id = MakeInteger(player ? -1 : pick(driver_count));
+            grid.car_id = MakeInteger(player ? -1 : pick(1000));
+            grid.unk3 = MakeFloat(player ? -1.0f : static_cast<f32>(pick(100)) / 100.0f);
+            grid.unk4 = MakeFloat(player ? -1.0f : static_cast<f32>(pick(100)) / 100.0f);
+        }
+        for (s32 k = 0; k < 12; k++) {
+            e.fame_earned_on_positions[k] = MakeInteger(std::max(0, 1200 - 100 * k));
+        }
+    });
+    Fill(tour.collections, "collections", std::max(1, tour_count / 4), [&](Collection& c, s32 i) {
+        c.id = MakeInteger(i);
+        c.name.Assign(fmt::format("COLLECTION_{}", i));
+        c.unk3 = MakeInteger(0);
+    });
+    return tour;
+}
+
+} // namespace Bench
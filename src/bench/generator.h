@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common/types.h"
+#include "tours.h"
+
+namespace Bench {
+
+struct GeneratorConfig {
+    s32 events = 10000;
+    s32 drivers = 500;
+    s32 vehicle_classes = 50;
+    u32 seed = 1;
+};
+
+// Builds a structurally valid DcTour with the given number of records. Strings and ids are drawn from small
+// pools the way real files reuse tracks, weather and LAMS ids, and every cross reference points at a record
+// that exists, so the result also passes validation.
+Evo::DcTour GenerateTour(const GeneratorConfig& config);
+
+} // namespace Bench
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "common/types.h"
+
+namespace Common {
+
+// Bump allocator for everything one conversion needs. Deallocation is a no-op; Reset() releases it all at once and
+// keeps the memory for the next conversion. When a round overflowed into more blocks, Reset() merges them into one
+// block big enough for the whole round, so a run of similar files soon stops allocating at all. Not thread safe:
+// give each worker its own.
+class Arena final : public std::pmr::memory_resource {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Everything allocated from the arena must be gone by now.
+    void Reset() {
+        if (blocks.size() > 1) {
+            const size_t total = capacity;
+            blocks.clear();
+            capacity = 0;
+            Grow(total);
+        } else if (!blocks.empty()) {
+            head = blocks.back().data.get();
+            remaining = blocks.back().size;
+        }
+    }
+
+    // Bytes held, whether in use or not.
+    size_t Capacity() const {
+        return capacity;
+    }
+
+private:
+    static constexpr size_t MinBlockSize = 64_KB;
+
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* p = head;
+        size_t space = remaining;
+        if (!std::align(alignment, bytes, p, space)) {
+            Grow(bytes + alignment);
+            p = head;
+            space = remaining;
+            std::align(alignment, bytes, p, space);
+        }
+        head = static_cast<std::byte*>(p) + bytes;
+        remaining = space - bytes;
+        return p;
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    void Grow(size_t at_least) {
+        // Doubling keeps the number of blocks logarithmic in the size of the round
+        const size_t size = std::max({at_least, MinBlockSize, blocks.empty() ? 0 : blocks.back().size * 2});
+        blocks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size});
+        capacity += size;
+        head = blocks.back().data.get();
+        remaining = size;
+    }
+
+    std::vector<Block> blocks;
+    size_t capacity = 0;
+    std::byte* head = nullptr;
+    size_t remaining = 0;
+};
+
+} // namespace Common
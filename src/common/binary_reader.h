@@ -0,0 +1,94 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "common/diagnostics.h"
+#include "common/types.h"
+#include "fmt/format.h"
+
+namespace Common {
+
+// Loads a little-endian integer from unaligned memory.
+template <typename T>
+T LoadLE(const char* ptr) {
+    static_assert(std::is_integral_v<T>);
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+// Copies `count` little-endian 32-bit words from src to dst in host order. This is a plain memcpy on little-endian
+// hosts; on big-endian ones the swap loop is simple enough for the compiler to vectorize into byte shuffles.
+inline void LoadLE32Block(void* dst, const char* src, size_t count) {
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(dst, src, count * sizeof(u32));
+    } else {
+        char* out = static_cast<char*>(dst);
+        for (size_t i = 0; i < count; i++) {
+            const u32 word = LoadLE<u32>(src + i * sizeof(u32));
+            std::memcpy(out + i * sizeof(u32), &word, sizeof(u32));
+        }
+    }
+}
+
+// Cursor over a bounded, little-endian byte buffer. Running past the end throws std::out_of_range
+// with the offset at which the data was truncated, so callers can report exactly where a file is short.
+// Records that fail validation are reported to the diagnostics sink, if there is one.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::span<const char> buffer, Diagnostics* diagnostics = nullptr)
+        : buffer{buffer}, diagnostics{diagnostics} {}
+
+    template <typename T>
+    T Read() {
+        return LoadLE<T>(Take(sizeof(T)));
+    }
+
+    std::string_view ReadBytes(size_t count) {
+        return std::string_view(Take(count), count);
+    }
+
+    const char* Take(size_t count) {
+        if (count > buffer.size() - offset) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Unexpected end of data at offset {:#x}: needed {} bytes, {} left",
+                                                offset, count, buffer.size() - offset));
+        }
+        const char* ptr = buffer.data() + offset;
+        offset += count;
+        return ptr;
+    }
+
+    size_t Offset() const {
+        return offset;
+    }
+    void Seek(size_t new_offset) {
+        if (new_offset > buffer.size()) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Seek to offset {:#x} past the end of data", new_offset));
+        }
+        offset = new_offset;
+    }
+    size_t Remaining() const {
+        return buffer.size() - offset;
+    }
+    std::span<const char> Data() const {
+        return buffer;
+    }
+    Diagnostics* GetDiagnostics() const {
+        return diagnostics;
+    }
+
+private:
+    std::span<const char> buffer;
+    size_t offset = 0;
+    Diagnostics* diagnostics;
+};
+
+} // namespace Common
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "common/types.h"
+#include "fmt/format.h"
+
+namespace Common {
+
+// Stores an integer to unaligned memory in little-endian order.
+template <typename T>
+void StoreLE(char* ptr, T value) {
+    static_assert(std::is_integral_v<T>);
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    std::memcpy(ptr, &value, sizeof(T));
+}
+
+// Copies `count` host-order 32-bit words from src to dst as little-endian, see LoadLE32Block.
+inline void StoreLE32Block(char* dst, const void* src, size_t count) {
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(dst, src, count * sizeof(u32));
+    } else {
+        const char* in = static_cast<const char*>(src);
+        for (size_t i = 0; i < count; i++) {
+            u32 word;
+            std::memcpy(&word, in + i * sizeof(u32), sizeof(u32));
+            StoreLE<u32>(dst + i * sizeof(u32), word);
+        }
+    }
+}
+
+// Little-endian encoder into a caller-provided buffer. The buffer is expected to be sized up front, so writing
+// past its end is a logic error and throws std::out_of_range.
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::span<char> buffer) : buffer{buffer} {}
+
+    template <typename T>
+    void Write(T value) {
+        StoreLE<T>(Take(sizeof(T)), value);
+    }
+
+    void WriteBytes(std::string_view bytes) {
+        std::memcpy(Take(bytes.size()), bytes.data(), bytes.size());
+    }
+
+    char* Take(size_t count) {
+        if (count > buffer.size() - offset) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Write of {} bytes at offset {:#x} overflows the {} byte buffer",
+                                                count, offset, buffer.size()));
+        }
+        char* ptr = buffer.data() + offset;
+        offset += count;
+        return ptr;
+    }
+
+    size_t Offset() const {
+        return offset;
+    }
+
+private:
+    std::span<char> buffer;
+    size_t offset = 0;
+};
+
+} // namespace Common
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+
+namespace Common {
+
+enum class Severity { Warning, Error };
+
+struct Diagnostic {
+    static constexpr size_t NoOffset = ~size_t{0};
+
+    Severity severity;
+    // JSON path such as "events.data[3].number_of_laps", or a byte offset for binary input
+    std::string location;
+    std::string message;
+    // Problems in JSON text are reported by offset, and JsonReader::ResolveLocations later turns the offsets into
+    // paths and line numbers for all of them in one pass: the value the location names, and the token whose line and
+    // column go after the message.
+    size_t value_offset = NoOffset;
+    size_t token_offset = NoOffset;
+
+    std::string ToString() const {
+        return fmt::format("{}: {}", location, message);
+    }
+};
+
+// Collects the problems found while loading one file, so that a single pass can report all of them instead of
+// stopping at the first. Not thread safe: parallel decoders give each task its own and Append them in order.
+class Diagnostics {
+public:
+    void Report(Severity severity, std::string location, std::string message) {
+        entries.push_back({severity, std::move(location), std::move(message)});
+        errors += severity == Severity::Error;
+    }
+    // Located by offsets into a JSON text, resolved later; see Diagnostic
+    void Report(Severity severity, size_t value_offset, std::string message,
+                size_t token_offset = Diagnostic::NoOffset) {
+        entries.push_back({severity, {}, std::move(message), value_offset, token_offset});
+        errors += severity == Severity::Error;
+    }
+
+    // Appends everything other found, after what is already here.
+    void Append(Diagnostics&& other) {
+        entries.insert(entries.end(), std::make_move_iterator(other.entries.begin()),
+                       std::make_move_iterator(other.entries.end()));
+        errors += other.errors;
+    }
+
+    bool HasErrors() const {
+        return errors != 0;
+    }
+    size_t ErrorCount() const {
+        return errors;
+    }
+    const std::vector<Diagnostic>& Entries() const {
+        return entries;
+    }
+    std::vector<Diagnostic>& Entries() {
+        return entries;
+    }
+
+private:
+    std::vector<Diagnostic> entries;
+    size_t errors = 0;
+};
+
+// Thrown by a record's Validate() when it breaks a rule of the format. Warnings do not stop a load.
+class ValidationError : public std::runtime_error {
+public:
+    ValidationError(Severity severity, const std::string& message)
+        : std::runtime_error{message}, severity{severity} {}
+
+    Severity severity;
+};
+
+} // namespace Common
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/types.h"
+
+namespace Common {
+
+inline u64 HashKey(s32 key) {
+    // Fibonacci hashing; its high bits are well mixed even for strided ids, so slots are taken from those
+    return static_cast<u64>(static_cast<u32>(key)) * 0x9E3779B97F4A7C15ull;
+}
+inline u64 HashKey(std::string_view key) {
+    return std::hash<std::string_view>{}(key);
+}
+
+// Open-addressing hash index from a key to the position of a record in some external array. Only the positions are
+// stored; keys are read back from the records through a key_of(position) callback, so the index stays valid when the
+// array reallocates and never copies strings. Linear probing over a power-of-two table, with backward-shift deletion
+// so there are no tombstones. Each slot keeps the high half of the key's hash and is addressed by its top bits.
+template <typename Key>
+class FlatIndex {
+public:
+    static constexpr u32 NotFound = ~0u;
+
+    void Clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    void Reserve(size_t n) {
+        // Keep the load factor at or below 1/2
+        const size_t wanted = std::bit_ceil(std::max<size_t>(n * 2, 16));
+        if (wanted > slots.size()) {
+            Rehash(wanted);
+        }
+    }
+
+    size_t Size() const {
+        return count;
+    }
+
+    template <typename KeyOf>
+    u32 Find(const Key& key, KeyOf&& key_of) const {
+        if (slots.empty()) {
+            return NotFound;
+        }
+        const u64 hash = HashKey(key);
+        for (size_t i = SlotFor(HighHalf(hash));; i = (i + 1) & Mask()) {
+            const Slot& slot = slots[i];
+            if (slot.position == NotFound) {
+                return NotFound;
+            }
+            if (slot.hash == HighHalf(hash) && key_of(slot.position) == key) {
+                return slot.position;
+            }
+        }
+    }
+
+    // Returns false, leaving the index unchanged, if the key is already present.
+    template <typename KeyOf>
+    bool Insert(const Key& key, u32 position, KeyOf&& key_of) {
+        Reserve(count + 1);
+        const u64 hash = HashKey(key);
+        size_t i = SlotFor(HighHalf(hash));
+        for (; slots[i].position != NotFound; i = (i + 1) & Mask()) {
+            if (slots[i].hash == HighHalf(hash) && key_of(slots[i].position) == key) {
+                return false;
+            }
+        }
+        slots[i] = {HighHalf(hash), position};
+        count++;
+        return true;
+    }
+
+    // Removes the entry for key if it points at position. Entries are matched by position, so no key is read back.
+    void Erase(const Key& key, u32 position) {
+        if (slots.empty()) {
+            return;
+        }
+        size_t i = SlotFor(HighHalf(HashKey(key)));
+        for (; slots[i].position != position; i = (i + 1) & Mask()) {
+            if (slots[i].position == NotFound) {
+                return;
+            }
+        }
+        // Pull later entries of the probe run back into the hole
+        for (size_t j = (i + 1) & Mask(); slots[j].position != NotFound; j = (j + 1) & Mask()) {
+            const size_t home = SlotFor(slots[j].hash);
+            if (((j - home) & Mask()) >= ((j - i) & Mask())) {
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i].position = NotFound;
+        count--;
+    }
+
+    // Renumbers positions after the record at `position` was removed from the array.
+    void ShiftDown(u32 position) {
+        for (Slot& slot : slots) {
+            if (slot.position != NotFound && slot.position > position) {
+                slot.position--;
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        u32 hash;
+        u32 position = NotFound;
+    };
+
+    size_t Mask() const {
+        return slots.size() - 1;
+    }
+    static u32 HighHalf(u64 hash) {
+        return static_cast<u32>(hash >> 32);
+    }
+    // The top log2(size) bits; multiplicative hashes leave the low bits of strided keys all equal
+    size_t SlotFor(u32 high) const {
+        return high >> shift;
+    }
+
+    void Rehash(size_t size) {
+        std::vector<Slot> old = std::exchange(slots, std::vector<Slot>(size));
+        shift = 32 - std::countr_zero(size);
+        for (const Slot& slot : old) {
+            if (slot.position != NotFound) {
+                size_t i = SlotFor(slot.hash);
+                while (slots[i].position != NotFound) {
+                    i = (i + 1) & Mask();
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+    int shift = 32;
+};
+
+} // namespace Common
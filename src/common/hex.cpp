@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <array>
+
+#include "common/hex.h"
+#include "common/types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HEX_USE_SSE2
+#endif
+
+namespace Common {
+
+// Both digits of every byte value, so encoding is one lookup per byte
+static constexpr auto EncodeTable = [] {
+    constexpr char digits[] = "0123456789abcdef";
+    std::array<char, 512> table{};
+    for (int i = 0; i < 256; i++) {
+        table[i * 2] = digits[i >> 4];
+        table[i * 2 + 1] = digits[i & 0xF];
+    }
+    return table;
+}();
+
+// Value of every hex digit, 0xFF for any other character
+static constexpr auto DecodeTable = [] {
+    std::array<u8, 256> table;
+    table.fill(0xFF);
+    for (int i = 0; i < 10; i++) {
+        table['0' + i] = static_cast<u8>(i);
+    }
+    for (int i = 0; i < 6; i++) {
+        table['a' + i] = static_cast<u8>(10 + i);
+        table['A' + i] = static_cast<u8>(10 + i);
+    }
+    return table;
+}();
+
+#ifdef HEX_USE_SSE2
+// 16 bytes to 32 digits.
+static void Encode16(const char* in, char* out) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const auto to_digits = [](__m128i nibbles) {
+        // '0' + n, plus the gap between '9' and 'a' where n > 9
+        const __m128i is_letter = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+        const __m128i digits = _mm_add_epi8(nibbles, _mm_set1_epi8('0'));
+        return _mm_add_epi8(digits, _mm_and_si128(is_letter, _mm_set1_epi8('a' - '0' - 10)));
+    };
+    const __m128i high = to_digits(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    const __m128i low = to_digits(_mm_and_si128(bytes, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+}
+
+// Values of 16 digits as 8 little-endian u16 lanes of high | low << 8, and whether all of them were hex digits.
+static __m128i DecodeDigits16(__m128i chars, __m128i& valid) {
+    // Both ranges are checked with signed compares; the subtraction maps each range onto [0, n) and everything
+    // else outside of it
+    const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(digit, _mm_set1_epi8(-1)),
+                                           _mm_cmplt_epi8(digit, _mm_set1_epi8(10)));
+    const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(letter, _mm_set1_epi8(-1)),
+                                            _mm_cmplt_epi8(letter, _mm_set1_epi8(6)));
+    valid = _mm_and_si128(valid, _mm_or_si128(is_digit, is_letter));
+    return _mm_or_si128(_mm_and_si128(is_digit, digit),
+                        _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+// 32 digits to 16 bytes. Returns false, leaving the block to the scalar path, unless all of them are hex digits.
+static bool Decode16(const char* in, char* out) {
+    __m128i valid = _mm_set1_epi8(-1);
+    const __m128i first = DecodeDigits16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), valid);
+    const __m128i second = DecodeDigits16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16)), valid);
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
+    }
+    const auto combine = [](__m128i pairs) {
+        const __m128i high = _mm_slli_epi16(_mm_and_si128(pairs, _mm_set1_epi16(0x00FF)), 4);
+        return _mm_or_si128(high, _mm_srli_epi16(pairs, 8));
+    };
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(combine(first), combine(second)));
+    return true;
+}
+#endif
+
+void HexEncode(std::string_view bytes, char* out) {
+    size_t i = 0;
+#ifdef HEX_USE_SSE2
+    for (; i + 16 <= bytes.size(); i += 16) {
+        Encode16(bytes.data() + i, out + i * 2);
+    }
+#endif
+    for (; i < bytes.size(); i++) {
+        const u8 byte = static_cast<u8>(bytes[i]);
+        out[i * 2] = EncodeTable[byte * 2];
+        out[i * 2 + 1] = EncodeTable[byte * 2 + 1];
+    }
+}
+
+bool HexDecode(std::string_view hex, char* out) {
+    if (hex.size() % 2 != 0) {
+        return false;
+    }
+    const size_t count = hex.size() / 2;
+    size_t i = 0;
+    while (i < count) {
+#ifdef HEX_USE_SSE2
+        if (i + 16 <= count && Decode16(hex.data() + i * 2, out + i)) {
+            i += 16;
+            continue;
+        }
+#endif
+        // One block of bytes at a time, so a padded digit only drops its own block off the fast path
+        const size_t block_end = std::min(count, i + 16);
+        for (; i < block_end; i++) {
+            const char high_char = hex[i * 2];
+            const u8 high = high_char == ' ' ? 0 : DecodeTable[static_cast<u8>(high_char)];
+            const u8 low = DecodeTable[static_cast<u8>(hex[i * 2 + 1])];
+            if ((high | low) & 0xF0) {
+                return false;
+            }
+            out[i] = static_cast<char>(high << 4 | low);
+        }
+    }
+    return true;
+}
+
+} // namespace Common
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string_view>
+
+namespace Common {
+
+// Writes 2 * bytes.size() lowercase hex digits to out.
+void HexEncode(std::string_view bytes, char* out);
+
+// Decodes two hex digits per byte into out, which must hold hex.size() / 2 bytes. Either case is accepted, as is a
+// space in place of a leading zero, which is what older versions wrote for bytes below 0x10. Returns false on an
+// odd length or an invalid digit.
+bool HexDecode(std::string_view hex, char* out);
+
+} // namespace Common
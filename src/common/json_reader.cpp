@@ -0,0 +1,589 @@
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <stdexcept>
+#include <vector>
+
+#include "common/json_reader.h"
+#include "common/utf8.h"
+#include "fmt/format.h"
+
+namespace Common {
+
+#ifdef JSON_USE_SSE2
+static __m128i Load16(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+static __m128i Equals(__m128i chunk, char c) {
+    return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+}
+#endif
+
+// Index of the first quote, backslash or control character at or after pos, i.e. where the plain run of characters
+// in a string ends; text.size() if there is none.
+static size_t FindStringSpecial(std::string_view text, size_t pos) {
+#ifdef JSON_USE_SSE2
+    for (; pos + 16 <= text.size(); pos += 16) {
+        const __m128i chunk = Load16(text.data() + pos);
+        // Unsigned c <= 0x1F
+        const __m128i control = Equals(_mm_max_epu8(chunk, _mm_set1_epi8(0x1F)), 0x1F);
+        const __m128i special = _mm_or_si128(_mm_or_si128(Equals(chunk, '"'), Equals(chunk, '\\')), control);
+        const u32 mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return pos + std::countr_zero(mask);
+        }
+    }
+#endif
+    while (pos < text.size() && text[pos] != '"' && text[pos] != '\\' && static_cast<u8>(text[pos]) >= 0x20) {
+        pos++;
+    }
+    return pos;
+}
+
+// Index of the first quote or bracket at or after pos; text.size() if there is none.
+static size_t FindStructural(std::string_view text, size_t pos) {
+#ifdef JSON_USE_SSE2
+    for (; pos + 16 <= text.size(); pos += 16) {
+        const __m128i chunk = Load16(text.data() + pos);
+        // Setting bit 5 maps '[' onto '{' and ']' onto '}'
+        const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        const u32 mask = _mm_movemask_epi8(
+            _mm_or_si128(Equals(chunk, '"'), _mm_or_si128(Equals(folded, '{'), Equals(folded, '}'))));
+        if (mask != 0) {
+            return pos + std::countr_zero(mask);
+        }
+    }
+#endif
+    while (pos < text.size() && text[pos] != '"' && (text[pos] | 0x20) != '{' && (text[pos] | 0x20) != '}') {
+        pos++;
+    }
+    return pos;
+}
+
+static bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Index of the first byte in [pos, end) that does not start a well-formed UTF-8 sequence; end if there is none. A
+// sequence that starts before end may run past it.
+static size_t FindInvalidUtf8(std::string_view text, size_t pos, size_t end) {
+    while (pos < end) {
+#ifdef JSON_USE_SSE2
+        // Most strings are plain ASCII, which is confirmed 16 bytes at a time
+        if (pos + 16 <= end && _mm_movemask_epi8(Load16(text.data() + pos)) == 0) {
+            pos += 16;
+            continue;
+        }
+#endif
+        if (static_cast<u8>(text[pos]) < 0x80) {
+            pos++;
+            continue;
+        }
+        const size_t len = Utf8SequenceLength(text, pos);
+        if (len == 0) {
+            return pos;
+        }
+        pos += len;
+    }
+    return end;
+}
+
+// True if a token NumberToken found follows the JSON grammar: an optional minus, no leading zeros, digits on both
+// sides of a decimal point and in an exponent.
+static bool IsJsonNumber(std::string_view token) {
+    size_t i = token.starts_with('-') ? 1 : 0;
+    const auto digits = [&] {
+        const size_t first = i;
+        while (i < token.size() && IsDigit(token[i])) {
+            i++;
+        }
+        return i > first;
+    };
+    if (i < token.size() && token[i] == '0') {
+        i++;
+    } else if (!digits()) {
+        return false;
+    }
+    if (i < token.size() && token[i] == '.' && (++i, !digits())) {
+        return false;
+    }
+    if (i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+        i++;
+        if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+            i++;
+        }
+        if (!digits()) {
+            return false;
+        }
+    }
+    return i == token.size();
+}
+
+void JsonReader::Error(std::string_view message) const {
+    if (diagnostics) {
+        // Reported through the sink, whose line and column numbers are all worked out at once in ResolveLocations
+        throw SyntaxError(std::string(message), pos);
+    }
+    // A single fatal error, so the rescan for its line and column costs little
+    const size_t end = std::min(pos, text.size());
+    const size_t line = std::count(text.begin(), text.begin() + end, '\n') + 1;
+    const size_t line_start = text.rfind('\n', end == 0 ? 0 : end - 1);
+    const size_t column = line_start == std::string_view::npos || end == 0 ? end + 1 : end - line_start;
+    throw SyntaxError(fmt::format("{} at line {}, column {}", message, line, column), pos);
+}
+
+namespace {
+// Follows the nesting of a document from the start, so the path of any offset can be read off on the way. Offsets
+// must be visited in increasing order; the scan only ever moves forward.
+class PathScanner {
+public:
+    explicit PathScanner(std::string_view text) : text{text} {}
+
+    // Path of the value at offset, like "events.data[3].number_of_laps"
+    std::string PathAt(size_t offset) {
+        for (const size_t end = std::min(offset, text.size()); i < end; i++) {
+            Step();
+        }
+        std::string path;
+        for (const Frame& frame : frames) {
+            if (frame.is_array) {
+                path += fmt::format("[{}]", frame.index);
+            } else if (!frame.expecting_key) {
+                if (!path.empty()) {
+                    path += '.';
+                }
+                path += frame.key;
+            }
+        }
+        return path.empty() ? "<root>" : path;
+    }
+
+private:
+    struct Frame {
+        bool is_array;
+        bool expecting_key;
+        size_t index;
+        std::string_view key;
+    };
+
+    void Step() {
+        switch (text[i]) {
+        case '{':
+            frames.push_back({false, true, 0, {}});
+            break;
+        case '[':
+            frames.push_back({true, false, 0, {}});
+            break;
+        case '}':
+        case ']':
+            if (!frames.empty()) {
+                frames.pop_back();
+            }
+            break;
+        case ',':
+            if (!frames.empty()) {
+                frames.back().index++;
+                frames.back().expecting_key = !frames.back().is_array;
+            }
+            break;
+        case '"': {
+            // Strings are taken whole, even past the offset asked for
+            const size_t start = ++i;
+            while (i < text.size() && text[i] != '"') {
+                i += text[i] == '\\' ? 2 : 1;
+            }
+            if (!frames.empty() && frames.back().expecting_key) {
+                frames.back().key = text.substr(start, std::min(i, text.size()) - start);
+                frames.back().expecting_key = false;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    std::string_view text;
+    size_t i = 0;
+    std::vector<Frame> frames;
+};
+} // namespace
+
+void JsonReader::ResolveLocations() const {
+    if (!diagnostics) {
+        return;
+    }
+    std::vector<Diagnostic>& entries = diagnostics->Entries();
+    // (offset, entry) pairs, visited in the order of the text
+    std::vector<std::pair<size_t, size_t>> values, tokens;
+    for (size_t e = 0; e < entries.size(); e++) {
+        if (entries[e].value_offset != Diagnostic::NoOffset) {
+            values.emplace_back(entries[e].value_offset, e);
+        }
+        if (entries[e].token_offset != Diagnostic::NoOffset) {
+            tokens.emplace_back(entries[e].token_offset, e);
+        }
+    }
+    std::ranges::sort(values);
+    std::ranges::sort(tokens);
+
+    PathScanner scanner(text);
+    for (const auto& [offset, e] : values) {
+        entries[e].location = scanner.PathAt(offset);
+        entries[e].value_offset = Diagnostic::NoOffset;
+    }
+    size_t line = 1, scanned = 0, line_start = std::string_view::npos;
+    for (const auto& [offset, e] : tokens) {
+        const size_t end = std::min(offset, text.size());
+        for (; scanned < end; scanned++) {
+            if (text[scanned] == '\n') {
+                line++;
+                line_start = scanned;
+            }
+        }
+        const size_t column = line_start == std::string_view::npos ? end + 1 : end - line_start;
+        entries[e].message += fmt::format(" at line {}, column {}", line, column);
+        entries[e].token_offset = Diagnostic::NoOffset;
+    }
+}
+
+void JsonReader::Recover(size_t start, const std::exception& e) {
+    const auto* syntax = dynamic_cast<const SyntaxError*>(&e);
+    diagnostics->Report(Severity::Error, start, e.what(), syntax ? syntax->offset : Diagnostic::NoOffset);
+    pos = start;
+    try {
+        SkipValue();
+    } catch (const std::exception&) {
+        // The value is malformed, not just of the wrong shape, so there is nothing sensible to resume from
+        throw Unrecoverable{};
+    }
+}
+
+void JsonReader::CheckUtf8(size_t begin, size_t end) {
+    const size_t invalid = FindInvalidUtf8(text, begin, end);
+    if (invalid != end) [[unlikely]] {
+        pos = invalid;
+        Error(fmt::format("Invalid UTF-8 byte 0x{:02X} in string", static_cast<u8>(text[invalid])));
+    }
+}
+
+void JsonReader::Expect(char c) {
+    if (!Consume(c)) [[unlikely]] {
+        Error(fmt::format("Expected '{}', got {}", c, TokenName()));
+    }
+}
+
+std::string_view JsonReader::TokenName() {
+    switch (Peek()) {
+    case '\0':
+        return "end of input";
+    case '{':
+        return "object";
+    case '[':
+        return "array";
+    case '"':
+        return "string";
+    case 't':
+    case 'f':
+        return "boolean";
+    case 'n':
+        return "null";
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+        const size_t start = pos;
+        bool is_float;
+        NumberToken(is_float);
+        pos = start;
+        return is_float ? "float" : "integer";
+    }
+    default:
+        return "invalid token";
+    }
+}
+
+std::string_view JsonReader::NumberToken(bool& is_float) {
+    SkipWhitespace();
+    const size_t start = pos;
+    is_float = false;
+    if (pos < text.size() && text[pos] == '-') {
+        pos++;
+    }
+    while (pos < text.size()) {
+        const char c = text[pos];
+        if (c == '.' || c == 'e' || c == 'E') {
+            is_float = true;
+        } else if ((c < '0' || c > '9') && c != '+' && c != '-') {
+            break;
+        }
+        pos++;
+    }
+    return text.substr(start, pos - start);
+}
+
+s64 JsonReader::ReadInteger() {
+    const size_t start = pos;
+    const char c = Peek();
+    if (c != '-' && (c < '0' || c > '9')) [[unlikely]] {
+        Error(fmt::format("Expected 'integer', got '{}'", TokenName()));
+    }
+    // Fast path: up to 19 digits always fit, and are accumulated straight away. Anything longer or followed by a
+    // fraction or exponent goes through the general parse below.
+    const size_t digits = pos + (c == '-');
+    size_t next = digits;
+    u64 value = 0;
+    while (next < text.size() && next - digits < 19 && IsDigit(text[next])) {
+        value = value * 10 + (text[next++] - '0');
+    }
+    const bool token_ends = next == text.size() || (!IsDigit(text[next]) && text[next] != '.' && text[next] != 'e' &&
+                                                    text[next] != 'E' && text[next] != '+' && text[next] != '-');
+    // A leading zero is only valid on its own
+    if (next != digits && token_ends && (text[digits] != '0' || next == digits + 1)) [[likely]] {
+        pos = next;
+        return c == '-' ? static_cast<s64>(0 - value) : static_cast<s64>(value);
+    }
+
+    bool is_float;
+    std::string_view token = NumberToken(is_float);
+    if (is_float) [[unlikely]] {
+        pos = start;
+        Error("Expected 'integer', got 'float'");
+    }
+    // Parsed as a magnitude and negated afterwards so that unsigned values wrap the same way nlohmann's did
+    const bool negative = token.front() == '-';
+    u64 magnitude = 0;
+    const auto [end, ec] = std::from_chars(token.data() + negative, token.data() + token.size(), magnitude);
+    if (ec != std::errc() || end != token.data() + token.size() || !IsJsonNumber(token)) [[unlikely]] {
+        pos = start;
+        Error(fmt::format("Invalid integer '{}'", token));
+    }
+    return negative ? static_cast<s64>(0 - magnitude) : static_cast<s64>(magnitude);
+}
+
+f64 JsonReader::ReadFloat() {
+    const size_t start = pos;
+    const char c = Peek();
+    if (c != '-' && (c < '0' || c > '9')) [[unlikely]] {
+        Error(fmt::format("Expected 'float', got '{}'", TokenName()));
+    }
+    bool is_float;
+    std::string_view token = NumberToken(is_float);
+    if (!is_float) [[unlikely]] {
+        pos = start;
+        Error("Expected 'float', got 'integer'");
+    }
+    f64 value = 0;
+    const auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (ec != std::errc() || end != token.data() + token.size() || !IsJsonNumber(token)) [[unlikely]] {
+        pos = start;
+        Error(fmt::format("Invalid float '{}'", token));
+    }
+    return value;
+}
+
+bool JsonReader::ReadBool() {
+    const char c = Peek();
+    if (text.substr(pos, 4) == "true") {
+        pos += 4;
+        return true;
+    }
+    if (text.substr(pos, 5) == "false") {
+        pos += 5;
+        return false;
+    }
+    Error(fmt::format("Expected 'boolean', got '{}'", c == 't' || c == 'f' ? "invalid token" : TokenName()));
+}
+
+static void AppendUtf8(std::string& out, u32 cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+std::string_view JsonReader::ReadString() {
+    if (Peek() != '"') [[unlikely]] {
+        Error(fmt::format("Expected 'string', got '{}'", TokenName()));
+    }
+    const size_t start = ++pos;
+    // Fast path: most strings have no escapes and can be handed out as a view of the source
+    pos = FindStringSpecial(text, pos);
+    CheckUtf8(start, pos);
+    if (pos < text.size() && text[pos] == '"') {
+        return text.substr(start, pos++ - start);
+    }
+
+    scratch.assign(text.substr(start, pos - start));
+    const auto read_hex4 = [this]() {
+        u32 value = 0;
+        const auto [end, ec] = std::from_chars(text.data() + pos, text.data() + std::min(pos + 4, text.size()),
+                                               value, 16);
+        if (ec != std::errc() || end != text.data() + pos + 4) [[unlikely]] {
+            Error("Invalid \\u escape");
+        }
+        pos += 4;
+        return value;
+    };
+    while (true) {
+        if (pos >= text.size()) [[unlikely]] {
+            Error("Unterminated string");
+        }
+        const char c = text[pos++];
+        if (c == '"') {
+            return scratch;
+        }
+        if (static_cast<u8>(c) < 0x20) [[unlikely]] {
+            pos--;
+            Error("Control character in string");
+        }
+        if (static_cast<u8>(c) >= 0x80) {
+            // Checks the sequence this byte leads and takes all of it
+            pos--;
+            CheckUtf8(pos, pos + 1);
+            const size_t len = Utf8SequenceLength(text, pos);
+            scratch.append(text.substr(pos, len));
+            pos += len;
+            continue;
+        }
+        if (c != '\\') {
+            scratch += c;
+            continue;
+        }
+        if (pos >= text.size()) [[unlikely]] {
+            Error("Unterminated string");
+        }
+        switch (text[pos++]) {
+        case '"':
+            scratch += '"';
+            break;
+        case '\\':
+            scratch += '\\';
+            break;
+        case '/':
+            scratch += '/';
+            break;
+        case 'b':
+            scratch += '\b';
+            break;
+        case 'f':
+            scratch += '\f';
+            break;
+        case 'n':
+            scratch += '\n';
+            break;
+        case 'r':
+            scratch += '\r';
+            break;
+        case 't':
+            scratch += '\t';
+            break;
+        case 'u': {
+            u32 cp = read_hex4();
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                if (text.substr(pos, 2) != "\\u") [[unlikely]] {
+                    Error("Unpaired surrogate in \\u escape");
+                }
+                pos += 2;
+                const u32 low = read_hex4();
+                if (low < 0xDC00 || low > 0xDFFF) [[unlikely]] {
+                    Error("Unpaired surrogate in \\u escape");
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            AppendUtf8(scratch, cp);
+            break;
+        }
+        default:
+            pos--;
+            Error("Invalid escape in string");
+        }
+    }
+}
+
+void JsonReader::SkipValue() {
+    switch (Peek()) {
+    case '{':
+        ReadObject([this](std::string_view) { SkipValue(); });
+        break;
+    case '[':
+        ReadArray([this] { SkipValue(); });
+        break;
+    case '"':
+        ReadString();
+        break;
+    case 't':
+    case 'f':
+        ReadBool();
+        break;
+    case 'n':
+        if (text.substr(pos, 4) != "null") [[unlikely]] {
+            Error("Invalid token");
+        }
+        pos += 4;
+        break;
+    default: {
+        const size_t start = pos;
+        bool is_float;
+        const std::string_view token = NumberToken(is_float);
+        if (token.empty()) [[unlikely]] {
+            Error(fmt::format("Unexpected {}", TokenName()));
+        }
+        if (!IsJsonNumber(token)) [[unlikely]] {
+            pos = start;
+            Error(fmt::format("Invalid number '{}'", token));
+        }
+        break;
+    }
+    }
+}
+
+void JsonReader::ScanValue() {
+    const char first = Peek();
+    if (first != '{' && first != '[') {
+        // Scalars are short, so the strict path costs nothing extra
+        SkipValue();
+        return;
+    }
+    size_t depth = 0;
+    while ((pos = FindStructural(text, pos)) < text.size()) {
+        const char c = text[pos++];
+        if (c == '"') {
+            while ((pos = FindStringSpecial(text, pos)) < text.size() && text[pos] != '"') {
+                pos += text[pos] == '\\' ? 2 : 1;
+            }
+            pos++;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (--depth == 0) {
+            return;
+        }
+    }
+    Error("Unterminated value");
+}
+
+void JsonReader::Finish() {
+    if (Peek() != '\0' || pos != text.size()) [[unlikely]] {
+        Error("Unexpected data after the end of the document");
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <bit>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "common/diagnostics.h"
+#include "common/types.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_USE_SSE2
+#endif
+
+namespace Common {
+
+// Pull-style JSON tokenizer over an in-memory document. The schema code drives it field by field and fills the
+// destination objects as values arrive, so no intermediate DOM is ever built. Errors throw SyntaxError with the line
+// and column of the offending token. With a Diagnostics sink, values read through ReadRecoverable that fail are
+// reported and skipped instead, so one pass finds every problem in the document; problems are reported by offset,
+// and ResolveLocations turns those into paths and line numbers at the end.
+class JsonReader {
+public:
+    // Thrown when a failed value cannot even be skipped, i.e. the document is not well-formed JSON past that
+    // point. The problem has already been reported to the diagnostics.
+    struct Unrecoverable {};
+
+    // With a Diagnostics sink the message leaves out the line and column, which are worked out from offset later.
+    struct SyntaxError : std::runtime_error {
+        SyntaxError(const std::string& message, size_t offset) : std::runtime_error{message}, offset{offset} {}
+
+        size_t offset;
+    };
+
+    explicit JsonReader(std::string_view text, Diagnostics* diagnostics = nullptr)
+        : text{text}, diagnostics{diagnostics} {}
+
+    // Calls on_key(key) for every member of the next object; on_key must consume exactly one value.
+    template <typename F>
+    void ReadObject(F&& on_key) {
+        Expect('{');
+        if (Consume('}')) {
+            return;
+        }
+        do {
+            std::string_view key = ReadString();
+            Expect(':');
+            on_key(key);
+        } while (Consume(','));
+        Expect('}');
+    }
+
+    // Calls on_element() for every element of the next array; on_element must consume exactly one value.
+    template <typename F>
+    void ReadArray(F&& on_element) {
+        Expect('[');
+        if (Consume(']')) {
+            return;
+        }
+        do {
+            on_element();
+        } while (Consume(','));
+        Expect(']');
+    }
+
+    // Runs read() on the next value. If it throws and there is a diagnostics sink, the error is reported at the
+    // path of the value, which is then skipped. The try block costs nothing while nothing fails.
+    template <typename F>
+    void ReadRecoverable(F&& read) {
+        SkipWhitespace();
+        const size_t start = pos;
+        try {
+            read();
+        } catch (const std::exception& e) {
+            if (!diagnostics) {
+                throw;
+            }
+            Recover(start, e);
+        }
+    }
+
+    s64 ReadInteger();
+    f64 ReadFloat();
+    bool ReadBool();
+    // The result points into the source text when the string has no escapes, and into an internal scratch
+    // buffer (valid until the next call) otherwise; see InSource().
+    std::string_view ReadString();
+    void SkipValue();
+    // Skips the next value by matching brackets and quotes only, without checking the tokens in between. Far
+    // cheaper than SkipValue for large values, for callers that find the extent of a value now and parse it properly
+    // later.
+    void ScanValue();
+    // Checks that nothing but whitespace follows the last value.
+    void Finish();
+
+    bool InSource(std::string_view s) const {
+        return s.data() >= text.data() && s.data() + s.size() <= text.data() + text.size();
+    }
+    size_t Offset() const {
+        return pos;
+    }
+    // Moves to offset, e.g. to start reading at a value another reader scanned over.
+    void Seek(size_t offset) {
+        pos = offset;
+    }
+    std::string_view Text() const {
+        return text;
+    }
+    Diagnostics* GetDiagnostics() const {
+        return diagnostics;
+    }
+    // Fills in the location, a path like "events.data[3].number_of_laps", and the line and column of every problem
+    // reported by offset, in a single pass over the document. Call once decoding is over, however it ended.
+    void ResolveLocations() const;
+
+    [[noreturn]] void Error(std::string_view message) const;
+
+private:
+    static bool IsWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+    void SkipWhitespace() {
+#ifdef JSON_USE_SSE2
+        // Pretty-printed documents put a newline and a run of indentation before most keys, which one compare of
+        // 16 bytes usually gets past
+        if (pos + 16 <= text.size() && IsWhitespace(text[pos])) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+            const __m128i space = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))));
+            const u32 other = ~static_cast<u32>(_mm_movemask_epi8(space)) & 0xFFFF;
+            if (other != 0) {
+                pos += std::countr_zero(other);
+                return;
+            }
+            pos += 16;
+        }
+#endif
+        while (pos < text.size() && IsWhitespace(text[pos])) {
+            pos++;
+        }
+    }
+    char Peek() {
+        SkipWhitespace();
+        return pos < text.size() ? text[pos] : '\0';
+    }
+    bool Consume(char c) {
+        if (Peek() == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+    void Expect(char c);
+    void Recover(size_t start, const std::exception& e);
+    // Fails at the first byte in [begin, end) that is not part of well-formed UTF-8, as nlohmann did
+    void CheckUtf8(size_t begin, size_t end);
+    std::string_view NumberToken(bool& is_float);
+    std::string_view TokenName();
+
+    std::string_view text;
+    size_t pos = 0;
+    std::string scratch;
+    Diagnostics* diagnostics;
+};
+
+} // namespace Common
@@ -0,0 +1,114 @@
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+#include "common/hex.h"
+#include "common/json_writer.h"
+#include "common/utf8.h"
+#include "fmt/format.h"
+#include "json.hpp"
+
+namespace Common {
+
+void JsonWriter::WriteInteger(s64 value) {
+    Prefix();
+    char chars[24];
+    const auto result = std::to_chars(chars, chars + sizeof(chars), value);
+    buffer.append(chars, result.ptr - chars);
+}
+
+void JsonWriter::WriteFloat(f64 value) {
+    Prefix();
+    if (!std::isfinite(value)) {
+        buffer += "null";
+        return;
+    }
+    // nlohmann's own float printer, so the digits match dump() exactly
+    char chars[64];
+    char* end = nlohmann::detail::to_chars(chars, chars + sizeof(chars), value);
+    buffer.append(chars, end - chars);
+}
+
+void JsonWriter::WriteBool(bool value) {
+    Prefix();
+    buffer += value ? "true" : "false";
+}
+
+void JsonWriter::WriteString(std::string_view value) {
+    Prefix();
+    WriteEscaped(value);
+}
+
+void JsonWriter::WriteHex(std::string_view bytes) {
+    Prefix();
+    buffer += '"';
+    const size_t start = buffer.size();
+    buffer.resize(start + bytes.size() * 2);
+    HexEncode(bytes, buffer.data() + start);
+    buffer += '"';
+}
+
+void JsonWriter::WriteEscaped(std::string_view s) {
+    buffer += '"';
+    size_t run_start = 0;
+    size_t i = 0;
+    while (i < s.size()) {
+        const u8 c = static_cast<u8>(s[i]);
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            i++;
+            continue;
+        }
+        if (c >= 0x80) {
+            const size_t len = Utf8SequenceLength(s, i);
+            if (len == 0) [[unlikely]] {
+                throw std::runtime_error(fmt::format("invalid UTF-8 byte at index {}: 0x{:02X}", i, c));
+            }
+            i += len;
+            continue;
+        }
+        buffer.append(s.substr(run_start, i - run_start));
+        switch (c) {
+        case '"':
+            buffer += "\\\"";
+            break;
+        case '\\':
+            buffer += "\\\\";
+            break;
+        case '\b':
+            buffer += "\\b";
+            break;
+        case '\t':
+            buffer += "\\t";
+            break;
+        case '\n':
+            buffer += "\\n";
+            break;
+        case '\f':
+            buffer += "\\f";
+            break;
+        case '\r':
+            buffer += "\\r";
+            break;
+        default:
+            buffer += fmt::format("\\u{:04x}", c);
+            break;
+        }
+        run_start = ++i;
+    }
+    buffer.append(s.substr(run_start));
+    buffer += '"';
+}
+
+void JsonWriter::Finish() {
+    buffer += '\n';
+    Flush();
+}
+
+void JsonWriter::Flush() {
+    if (sink) {
+        sink->write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+}
+
+} // namespace Common
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/types.h"
+
+namespace Common {
+
+// Streaming JSON writer producing the same text as nlohmann's dump(2): two-space indentation, "key": value
+// members, and numbers and string escapes formatted identically. Output is collected in a buffer that is handed
+// to the sink in large blocks, or kept in memory when there is no sink.
+class JsonWriter {
+public:
+    // An existing buffer can be passed in to reuse its capacity; its contents are discarded.
+    explicit JsonWriter(std::ostream* sink = nullptr, std::string buffer = {})
+        : sink{sink}, buffer{std::move(buffer)} {
+        this->buffer.clear();
+        this->buffer.reserve(sink ? FlushThreshold : 0);
+    }
+
+    JsonWriter& BeginObject() {
+        Prefix();
+        buffer += '{';
+        Open();
+        return *this;
+    }
+    JsonWriter& EndObject() {
+        Close('}');
+        return *this;
+    }
+    JsonWriter& BeginArray() {
+        Prefix();
+        buffer += '[';
+        Open();
+        return *this;
+    }
+    JsonWriter& EndArray() {
+        Close(']');
+        return *this;
+    }
+    JsonWriter& Key(std::string_view key) {
+        Prefix();
+        WriteEscaped(key);
+        buffer += compact ? ":" : ": ";
+        after_key = true;
+        return *this;
+    }
+
+    void WriteInteger(s64 value);
+    void WriteFloat(f64 value);
+    void WriteBool(bool value);
+    void WriteString(std::string_view value);
+    // Writes bytes as a string of hex digits, encoded straight into the output buffer.
+    void WriteHex(std::string_view bytes);
+
+    // A writer for values that belong inside the array or object this one has open, so they can be produced
+    // elsewhere, e.g. on another thread, and added back with Splice(). `preceded` tells whether values from
+    // earlier fragments will have been spliced in before this one's. The result is the same text as writing the
+    // values here directly.
+    JsonWriter Fragment(bool preceded, std::string fragment_buffer = {}) const {
+        JsonWriter fragment(nullptr, std::move(fragment_buffer));
+        fragment.has_items = has_items;
+        fragment.has_items.back() = fragment.has_items.back() || preceded;
+        return fragment;
+    }
+    void Splice(const JsonWriter& fragment) {
+        buffer += fragment.buffer;
+        has_items.back() = has_items.back() || fragment.has_items.back();
+        if (sink && buffer.size() >= FlushThreshold) {
+            Flush();
+        }
+    }
+
+    // Leaves out all whitespace from here on, e.g. to write one document per line as in JSON Lines.
+    void SetCompact(bool enable) {
+        compact = enable;
+    }
+
+    // Terminates the document with a newline, like std::endl did, and flushes everything to the sink.
+    void Finish();
+    void Flush();
+
+    std::string& Buffer() {
+        return buffer;
+    }
+
+private:
+    static constexpr size_t FlushThreshold = 1_MB;
+
+    void Prefix() {
+        if (after_key) {
+            after_key = false;
+        } else if (!has_items.empty()) {
+            if (compact) {
+                buffer += has_items.back() ? "," : "";
+            } else {
+                buffer += has_items.back() ? ",\n" : "\n";
+                buffer.append(has_items.size() * 2, ' ');
+            }
+            has_items.back() = true;
+        }
+    }
+    void Open() {
+        has_items.push_back(false);
+    }
+    void Close(char c) {
+        const bool had_items = has_items.back();
+        has_items.pop_back();
+        if (had_items && !compact) {
+            buffer += '\n';
+            buffer.append(has_items.size() * 2, ' ');
+        }
+        buffer += c;
+        if (sink && buffer.size() >= FlushThreshold) {
+            Flush();
+        }
+    }
+    void WriteEscaped(std::string_view s);
+
+    std::ostream* sink;
+    std::string buffer;
+    std::vector<bool> has_items;
+    bool after_key = false;
+    bool compact = false;
+};
+
+} // namespace Common
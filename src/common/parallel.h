@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+inline size_t WorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+namespace Detail {
+// Cores the current thread may spread work over; 0 outside any ParallelFor, where that is all of them
+inline thread_local size_t worker_budget = 0;
+} // namespace Detail
+
+// Threads worth starting from the current one: all cores, or inside a ParallelFor the cores it left to this worker,
+// so nested parallel loops (a parallel decode within a batch of files, say) do not start cores x cores threads.
+inline size_t AvailableWorkers() {
+    return Detail::worker_budget != 0 ? Detail::worker_budget : WorkerCount();
+}
+
+// Runs fn(index, worker) for every index in [0, count) on a pool of up to `workers` threads, where worker is a
+// stable id in [0, workers) that callers can use to pick per-thread scratch state. Indices are handed out one at a
+// time so uneven items balance out. The first exception thrown by fn stops the remaining work and is rethrown here.
+// The available cores are split evenly between the workers, for any ParallelFor they run in turn.
+template <typename F>
+void ParallelFor(size_t count, F&& fn, size_t workers = AvailableWorkers()) {
+    workers = std::min(workers, count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            fn(i, size_t{0});
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    const size_t share = std::max<size_t>(1, AvailableWorkers() / workers);
+    const size_t caller_budget = Detail::worker_budget;
+    const auto run = [&](size_t worker) {
+        Detail::worker_budget = share;
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                fn(i, worker);
+            } catch (...) {
+                std::scoped_lock lock{error_mutex};
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = count;
+            }
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (size_t worker = 1; worker < workers; worker++) {
+        threads.emplace_back(run, worker);
+    }
+    run(0);
+    Detail::worker_budget = caller_budget;
+    threads.clear();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace Common
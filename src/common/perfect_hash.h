@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <stdexcept>
+#include <string_view>
+
+#include "common/types.h"
+
+namespace Common {
+
+// Collision-free hash table over a fixed set of keys, built at compile time. A lookup hashes the key once and
+// compares it against the single candidate in its slot, instead of comparing it against every key in turn. The
+// table has four slots per key, so a seed that spreads the keys into distinct slots turns up after a few tries.
+template <size_t N>
+class PerfectHash {
+public:
+    static constexpr size_t NotFound = N;
+
+    consteval explicit PerfectHash(const std::array<std::string_view, N>& keys) : keys{keys} {
+        // Field names nearly always differ in length or in their first, middle or last character, which is much
+        // cheaper to hash than the whole name; the whole name is only hashed for sets where that is not enough
+        for (const bool sample : {true, false}) {
+            sampled = sample;
+            for (seed = 0; seed < 1000; seed++) {
+                if (TryBuild()) {
+                    return;
+                }
+            }
+        }
+        // Only reachable with duplicate keys; throwing here fails the compilation
+        throw std::logic_error("No perfect hash for these keys");
+    }
+
+    // Index of key in the key list, or NotFound.
+    constexpr size_t Find(std::string_view key) const {
+        const u8 index = slots[Slot(key)];
+        return index != Empty && keys[index] == key ? index : NotFound;
+    }
+
+private:
+    static_assert(N < 255, "Slots store key indices as bytes");
+    static constexpr size_t TableBits = std::bit_width(std::bit_ceil(N * 4) - 1);
+    static constexpr u8 Empty = 0xFF;
+
+    constexpr size_t Slot(std::string_view key) const {
+        u64 h = key.size();
+        if (sampled) {
+            if (!key.empty()) {
+                h |= static_cast<u64>(static_cast<u8>(key.front())) << 8 |
+                     static_cast<u64>(static_cast<u8>(key[key.size() / 2])) << 16 |
+                     static_cast<u64>(static_cast<u8>(key.back())) << 24;
+            }
+        } else {
+            // FNV-1a
+            h ^= 0xCBF29CE484222325ull;
+            for (const char c : key) {
+                h = (h ^ static_cast<u8>(c)) * 0x100000001B3ull;
+            }
+        }
+        // Mix in the seed, fold the high half onto the low one, then take the top bits of a Fibonacci multiply
+        h += seed * 0xD6E8FEB86659FD93ull;
+        h ^= h >> 32;
+        return static_cast<size_t>((h * 0x9E3779B97F4A7C15ull) >> (64 - TableBits));
+    }
+
+    constexpr bool TryBuild() {
+        slots.fill(Empty);
+        for (size_t i = 0; i < N; i++) {
+            u8& slot = slots[Slot(keys[i])];
+            if (slot != Empty) {
+                return false;
+            }
+            slot = static_cast<u8>(i);
+        }
+        return true;
+    }
+
+    std::array<std::string_view, N> keys;
+    std::array<u8, size_t{1} << TableBits> slots{};
+    u64 seed = 0;
+    bool sampled = true;
+};
+
+} // namespace Common
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+
+#include "common/flat_index.h"
+#include "common/types.h"
+
+namespace Common {
+
+// Interning table: stores one copy of every distinct string it is given. Equal strings come back as the same view,
+// so two interned views are equal exactly when their data pointers are. The copies live as long as the pool.
+class StringPool {
+public:
+    explicit StringPool(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : chars{resource}, entries{resource} {}
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    static constexpr u32 NotFound = FlatIndex<std::string_view>::NotFound;
+
+    std::string_view Intern(std::string_view s) {
+        return entries[InternId(s)];
+    }
+
+    // Like Intern, but returns the position of the copy. Ids are dense and handed out in order of first sight.
+    u32 InternId(std::string_view s) {
+        const u32 found = Find(s);
+        if (found != NotFound) {
+            return found;
+        }
+        if (s.empty()) {
+            // Still needs a non-null pointer, which is how a String tells a borrowed view from its own storage
+            static constexpr char empty[] = "";
+            entries.push_back(std::string_view(empty, 0));
+        } else {
+            char* copy = static_cast<char*>(chars.allocate(s.size(), 1));
+            std::memcpy(copy, s.data(), s.size());
+            entries.push_back(std::string_view(copy, s.size()));
+        }
+        const u32 id = static_cast<u32>(entries.size() - 1);
+        index.Insert(entries.back(), id, [this](u32 position) { return entries[position]; });
+        return id;
+    }
+
+    // Id of s if it was interned, NotFound otherwise
+    u32 Find(std::string_view s) const {
+        return index.Find(s, [this](u32 position) { return entries[position]; });
+    }
+
+    std::string_view operator[](u32 id) const {
+        return entries[id];
+    }
+
+    // Number of distinct strings
+    size_t Size() const {
+        return entries.size();
+    }
+
+private:
+    std::pmr::monotonic_buffer_resource chars;
+    std::pmr::vector<std::string_view> entries;
+    FlatIndex<std::string_view> index;
+};
+
+} // namespace Common
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string_view>
+
+#include "common/types.h"
+
+namespace Common {
+
+// Length of the UTF-8 sequence starting at s[i], or 0 if it is malformed.
+inline size_t Utf8SequenceLength(std::string_view s, size_t i) {
+    const u8 lead = static_cast<u8>(s[i]);
+    size_t len;
+    u32 cp;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        len = 2;
+        cp = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        len = 3;
+        cp = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        len = 4;
+        cp = lead & 0x07;
+    } else {
+        return 0;
+    }
+    if (i + len > s.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < len; k++) {
+        const u8 c = static_cast<u8>(s[i + k]);
+        if ((c & 0xC0) != 0x80) {
+            return 0;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    const bool overlong = (len == 3 && cp < 0x800) || (len == 4 && cp < 0x10000);
+    if (overlong || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+        return 0;
+    }
+    return len;
+}
+
+} // namespace Common
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string_view>
+
+namespace Common {
+
+// Matches s against a pattern where * stands for any run of characters and ? for any one character.
+inline bool WildcardMatch(std::string_view pattern, std::string_view s) {
+    size_t p = 0, i = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (i < s.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == s[i])) {
+            p++;
+            i++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = i;
+        } else if (star != std::string_view::npos) {
+            // Let the last star swallow one more character and retry from there
+            p = star + 1;
+            i = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+} // namespace Common
@@ -1,6 +1,14 @@
 #pragma once
 
+#include <memory_resource>
+#include <vector>
+
 #include "common/assert.h"
+#include "common/binary_reader.h"
+#include "common/binary_writer.h"
+#include "common/hex.h"
+#include "common/json_reader.h"
+#include "common/json_writer.h"
 #include "common/logging.h"
 #include "common/types.h"
 #include "json.hpp"
@@ -41,18 +49,23 @@ static inline value_t merge_compatible_types(value_t type) {
     return type;
 }
 
+// Throws instead of asserting, so a bad document fails its own load and not the whole process
 #define ASSERT_JSON_TYPE(VALUE, TYPE)                                                                                  \
-    ASSERT_MSG(merge_compatible_types(VALUE.type()) == merge_compatible_types(value_t::TYPE),                          \
-               "Expected '{}', got '{}'", json_value_type_name(value_t::TYPE), json_value_type_name(VALUE));
+    do {                                                                                                               \
+        if (merge_compatible_types(VALUE.type()) != merge_compatible_types(value_t::TYPE)) [[unlikely]] {              \
+            throw std::runtime_error(fmt::format("Expected '{}', got '{}'", json_value_type_name(value_t::TYPE),       \
+                                                 json_value_type_name(VALUE.type())));                                 \
+        }                                                                                                              \
+    } while (0)
 
 namespace Evo {
 
+// Base of all records. Validate() is resolved statically: records that need checks hide it with their own, and
+// the serializers always call it on the concrete type, so no vtable is needed and plain records stay trivially
+// copyable.
 class DataType {
 public:
-    virtual void Validate() const {
-        return;
-    }
-    virtual ~DataType() = default;
+    void Validate() const {}
 };
 
 class Integer {
@@ -128,63 +141,136 @@ inline void from_json(const nlohmann::ordered_json& j, Boolean& b) {
     b.data = j.get<bool>() ? 1 : 0;
 }
 
+// A length-prefixed string. Strings decoded from a file borrow their bytes from the loaded file buffer, or from the pool
+// they are interned into once DcTour::InternStrings has run (either kept alive by DcTour::backing), and switch to an
+// owned copy as soon as they are edited.
 class String {
 public:
-    Integer len;
-    std::vector<char> data;
-    operator std::string() const {
-        if (len.data == 0) {
-            return "";
+    String() = default;
+    String(std::string_view s) {
+        Assign(s);
+    }
+
+    // The bytes must outlive this String and every copy of it.
+    void Borrow(std::string_view s) {
+        borrowed = s;
+        owned.clear();
+    }
+    void Assign(std::string_view s) {
+        owned.assign(s);
+        borrowed = {};
+    }
+    // Replaces the contents with `size` owned bytes for the caller to fill in.
+    char* Reset(size_t size) {
+        owned.resize(size);
+        borrowed = {};
+        return owned.data();
+    }
+    // Gives write access to the bytes, copying them out of the borrowed buffer first.
+    char* MutableData() {
+        if (borrowed.data() != nullptr) {
+            Assign(std::string(borrowed));
         }
-        return std::string(data.data());
+        return owned.data();
+    }
+
+    std::string_view view() const {
+        return borrowed.data() != nullptr ? borrowed : std::string_view(owned);
+    }
+    const char* data() const {
+        return view().data();
+    }
+    s32 size() const {
+        return static_cast<s32>(view().size());
+    }
+    bool empty() const {
+        return view().empty();
+    }
+    // Interned strings with the same contents share their bytes, so equal ones usually match on the pointer alone
+    bool operator==(const String& other) const {
+        const std::string_view a = view(), b = other.view();
+        return (a.data() == b.data() && a.size() == b.size()) || a == b;
+    }
+
+    operator std::string() const {
+        return str();
     }
     std::string str() const {
-        return std::string(data.data());
+        return std::string(view());
     }
     std::string hex_str() const {
-        std::string hs = "";
-        for (int i = 0; i < len.data; i++) {
-            hs = fmt::format("{}{:2x}", hs, (u8)data[i]);
-        }
+        std::string hs(view().size() * 2, '\0');
+        Common::HexEncode(view(), hs.data());
         return hs;
     }
+
+private:
+    std::string_view borrowed;
+    std::string owned;
 };
 inline void to_json(nlohmann::ordered_json& j, const String& s) {
     j = s.str();
 }
 inline void from_json(const nlohmann::ordered_json& j, String& s) {
     ASSERT_JSON_TYPE(j, string);
-    std::string tmp = j.get<std::string>();
-    s.len.data = tmp.size();
-    s.data.resize(s.len.data + 1);
-    std::copy(tmp.begin(), tmp.end(), s.data.begin());
-    s.data[s.len.data] = '\0';
+    s.Assign(j.get_ref<const std::string&>());
 }
 
-class HexString : public String {};
+class HexString : public String {
+public:
+    void AssignHex(std::string_view hex) {
+        if (hex.size() % 2 != 0) [[unlikely]] {
+            throw std::invalid_argument(fmt::format("Hex string '{}' has an odd number of characters", hex));
+        }
+        if (!Common::HexDecode(hex, Reset(hex.size() / 2))) [[unlikely]] {
+            throw std::invalid_argument(fmt::format("Hex string '{}' has an invalid digit", hex));
+        }
+    }
+};
 inline void to_json(nlohmann::ordered_json& j, const HexString& s) {
     j = s.hex_str();
 }
 inline void from_json(const nlohmann::ordered_json& j, HexString& s) {
     ASSERT_JSON_TYPE(j, string);
-    std::string hex = j.get<std::string>();
-    size_t len = hex.size();
-    ASSERT_MSG(len % 2 == 0, "Hex string '{}' has an odd number of characters", hex);
-    s.len.data = len / 2;
-    s.data.resize(s.len.data + 1);
-    for (s32 i = 0; i < s.len.data; ++i) {
-        std::string byte_str = hex.substr(i * 2, 2);
-        s.data[i] = static_cast<char>(std::stoul(byte_str, nullptr, 16));
-    }
-    s.data[s.len.data] = '\0';
+    s.AssignHex(j.get_ref<const std::string&>());
 }
 
+// Leaf serializers, defined in tours.cpp
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Integer& i);
+Common::BinaryReader& operator>>(Common::BinaryReader& r, String& s);
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Boolean& b);
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Float& f);
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Integer& i);
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const String& s);
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Boolean& b);
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Float& f);
+size_t BinarySize(const Integer&);
+size_t BinarySize(const String& s);
+size_t BinarySize(const Boolean&);
+size_t BinarySize(const Float&);
+Common::JsonReader& operator>>(Common::JsonReader& r, Integer& i);
+Common::JsonReader& operator>>(Common::JsonReader& r, String& s);
+Common::JsonReader& operator>>(Common::JsonReader& r, HexString& s);
+Common::JsonReader& operator>>(Common::JsonReader& r, Boolean& b);
+Common::JsonReader& operator>>(Common::JsonReader& r, Float& f);
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Integer& i);
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const String& s);
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const HexString& s);
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Boolean& b);
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Float& f);
+
 template <typename T>
 class Array {
 public:
+    using value_type = T;
+
+    Array() = default;
+    // The records are allocated from resource, which must outlive the array.
+    explicit Array(std::pmr::memory_resource* resource) : data{resource} {}
+
     String name;
     Integer size;
-    std::vector<T> data;
+    std::pmr::vector<T> data;
     T& operator[](const size_t index) {
         return data[index];
     }
@@ -192,6 +278,11 @@ public:
         return data[index];
     }
 };
+template <typename T>
+constexpr bool IsArray = false;
+template <typename T>
+constexpr bool IsArray<Array<T>> = true;
+
 template <typename T>
 inline void to_json(nlohmann::ordered_json& j, const Array<T>& arr) {
     j = nlohmann::ordered_json{{"name", arr.name}, {"data", arr.data}};
@@ -201,30 +292,90 @@ template <typename T>
 inline void from_json(const nlohmann::ordered_json& j, Array<T>& arr) {
     ASSERT_JSON_TYPE(j, object);
     arr.name = j.at("name").get<String>();
-    arr.data = j.at("data").get<std::vector<T>>();
+    const auto data = j.at("data").get<std::vector<T>>();
+    arr.data.assign(data.begin(), data.end());
     arr.size = arr.data.size();
 }
+// Reads the name and record count of an array and sizes its storage, leaving r at the first record.
 template <typename T>
-std::istream& operator>>(std::istream& is, Array<T>& a) {
-    is >> a.name >> a.size;
+void ReadArrayHeader(Common::BinaryReader& r, Array<T>& a) {
+    r >> a.name >> a.size;
+    // every record is at least one byte long, so a count larger than what is left can only be garbage
+    if (a.size < 0 || static_cast<size_t>(a.size) > r.Remaining()) [[unlikely]] {
+        throw std::out_of_range(fmt::format("Invalid size {} for array '{}' at offset {:#x}", a.size.data,
+                                            a.name.str(), r.Offset()));
+    }
     a.data.resize(a.size);
+}
+template <typename T>
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Array<T>& a) {
+    ReadArrayHeader(r, a);
     for (int i = 0; i < a.size; i++) {
-        is >> a.data[i];
+        r >> a.data[i];
     }
-    return is;
+    return r;
 }
 template <typename T>
-std::ostream& operator<<(std::ostream& os, Array<T>& a) {
-    os << a.name << a.size;
-    for (int i = 0; i < a.size; i++) {
-        os << a[i];
+Common::JsonReader& operator>>(Common::JsonReader& r, Array<T>& a) {
+    bool has_name = false, has_data = false;
+    r.ReadObject([&](std::string_view key) {
+        if (key == "name") {
+            r >> a.name;
+            has_name = true;
+        } else if (key == "data") {
+            a.data.clear();
+            r.ReadArray([&] {
+                T& item = a.data.emplace_back();
+                r.ReadRecoverable([&] { r >> item; });
+            });
+            has_data = true;
+        } else {
+            r.SkipValue();
+        }
+    });
+    if (!has_name || !has_data) [[unlikely]] {
+        r.Error(fmt::format("Missing key '{}'", has_name ? "data" : "name"));
+    }
+    a.size.data = static_cast<s32>(a.data.size());
+    return r;
+}
+template <typename T>
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Array<T>& a) {
+    w.BeginObject();
+    w.Key("name") << a.name;
+    w.Key("data").BeginArray();
+    for (const T& item : a.data) {
+        w << item;
     }
-    return os;
+    w.EndArray();
+    w.EndObject();
+    return w;
+}
+template <typename T>
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Array<T>& a) {
+    ASSERT_MSG(a.size == static_cast<s32>(a.data.size()), "Array '{}' has size {} but holds {} items", a.name.str(),
+               a.size.data, a.data.size());
+    w << a.name << a.size;
+    for (const T& item : a.data) {
+        w << item;
+    }
+    return w;
+}
+template <typename T>
+size_t BinarySize(const Array<T>& a) {
+    size_t size = BinarySize(a.name) + BinarySize(a.size);
+    for (const T& item : a.data) {
+        size += BinarySize(item);
+    }
+    return size;
 }
 
 template <typename T, s32 size>
 class FixedArray {
 public:
+    using value_type = T;
+    static constexpr s32 count = size;
+
     std::array<T, size> data;
     T& operator[](const size_t index) {
         return data[index];
@@ -233,6 +384,11 @@ public:
         return data[index];
     }
 };
+template <typename T>
+constexpr bool IsFixedArray = false;
+template <typename T, s32 size>
+constexpr bool IsFixedArray<FixedArray<T, size>> = true;
+
 template <typename T, s32 size>
 inline void to_json(nlohmann::ordered_json& j, const FixedArray<T, size>& a) {
     j = a.data;
@@ -242,22 +398,57 @@ template <typename T, s32 size>
 inline void from_json(const nlohmann::ordered_json& j, FixedArray<T, size>& arr) {
     ASSERT_JSON_TYPE(j, array);
     auto d = j.get<std::vector<T>>();
-    ASSERT_MSG(d.size() == size, "Expected array of length {}, got {}", size, d.size());
+    if (d.size() != size) [[unlikely]] {
+        throw std::runtime_error(fmt::format("Expected array of length {}, got {}", size, d.size()));
+    }
     std::copy_n(d.begin(), size, arr.data.begin());
 }
 template <typename T, s32 size>
-std::istream& operator>>(std::istream& is, FixedArray<T, size>& a) {
+Common::BinaryReader& operator>>(Common::BinaryReader& r, FixedArray<T, size>& a) {
     for (size_t i = 0; i < a.data.size(); i++) {
-        is >> a.data[i];
+        r >> a.data[i];
     }
-    return is;
+    return r;
 }
 template <typename T, s32 size>
-std::ostream& operator<<(std::ostream& os, FixedArray<T, size>& a) {
-    for (size_t i = 0; i < a.data.size(); i++) {
-        os << a.data[i];
+Common::JsonReader& operator>>(Common::JsonReader& r, FixedArray<T, size>& a) {
+    s32 count = 0;
+    r.ReadArray([&] {
+        if (count < size) {
+            r.ReadRecoverable([&] { r >> a.data[count]; });
+        } else {
+            r.SkipValue();
+        }
+        count++;
+    });
+    if (count != size) [[unlikely]] {
+        r.Error(fmt::format("Expected array of length {}, got {}", size, count));
+    }
+    return r;
+}
+template <typename T, s32 size>
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const FixedArray<T, size>& a) {
+    w.BeginArray();
+    for (const T& item : a.data) {
+        w << item;
+    }
+    w.EndArray();
+    return w;
+}
+template <typename T, s32 size>
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const FixedArray<T, size>& a) {
+    for (const T& item : a.data) {
+        w << item;
+    }
+    return w;
+}
+template <typename T, s32 size>
+size_t BinarySize(const FixedArray<T, size>& a) {
+    size_t total = 0;
+    for (const T& item : a.data) {
+        total += BinarySize(item);
     }
-    return os;
+    return total;
 }
 
 } // namespace Evo
\ No newline at end of file
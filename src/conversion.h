@@ -1,31 +1,467 @@
 #pragma once
 
-#define JSON_STREAM_IN(x) << t.x
-#define JSON_STREAM_OUT(x) >> t.x
-
-#define NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_VALIDATION(Type, ...)                                                  \
-    template <typename BasicJsonType,                                                                                  \
-              nlohmann::detail::enable_if_t<nlohmann::detail::is_basic_json<BasicJsonType>::value, int> = 0>           \
-    void to_json(BasicJsonType& nlohmann_json_j, const Type& nlohmann_json_t) {                                        \
-        nlohmann_json_t.Validate();                                                                                    \
-        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(NLOHMANN_JSON_TO, __VA_ARGS__))                                       \
-    }                                                                                                                  \
-    template <typename BasicJsonType,                                                                                  \
-              nlohmann::detail::enable_if_t<nlohmann::detail::is_basic_json<BasicJsonType>::value, int> = 0>           \
-    void from_json(const BasicJsonType& nlohmann_json_j, Type& nlohmann_json_t) {                                      \
-        NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(NLOHMANN_JSON_FROM, __VA_ARGS__))                                     \
-        nlohmann_json_t.Validate();                                                                                    \
-    }
-
-#define DECLARE_BINARY_AND_JSON_OPERATIONS(Type, ...)                                                                  \
-    NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE_WITH_VALIDATION(Type, __VA_ARGS__)                                              \
-    std::istream& operator>>(std::istream& is, Type& t) {                                                              \
-        is NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(JSON_STREAM_OUT, __VA_ARGS__));                                    \
-        t.Validate();                                                                                                  \
-        return is;                                                                                                     \
-    }                                                                                                                  \
-    std::ostream& operator<<(std::ostream& os, Type& t) {                                                              \
-        t.Validate();                                                                                                  \
-        os NLOHMANN_JSON_EXPAND(NLOHMANN_JSON_PASTE(JSON_STREAM_IN, __VA_ARGS__));                                     \
-        return os;                                                                                                     \
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "common/binary_reader.h"
+#include "common/binary_writer.h"
+#include "common/diagnostics.h"
+#include "common/json_reader.h"
+#include "common/json_writer.h"
+#include "common/logging.h"
+#include "common/perfect_hash.h"
+#include "common_data_types.h"
+#include "fmt/format.h"
+#include "json.hpp"
+
+namespace Evo {
+
+// How a member is represented, both on disk and in JSON
+enum class WireKind { Integer, Float, Boolean, String, HexString, Array, FixedArray, Record };
+
+// Name of a kind for messages, e.g. "Expected a float"
+constexpr std::string_view KindName(WireKind kind) {
+    switch (kind) {
+    case WireKind::Integer:
+        return "integer";
+    case WireKind::Float:
+        return "float";
+    case WireKind::Boolean:
+        return "boolean";
+    case WireKind::String:
+        return "string";
+    case WireKind::HexString:
+        return "hex string";
+    case WireKind::Array:
+        return "array";
+    case WireKind::FixedArray:
+        return "fixed array";
+    case WireKind::Record:
+        return "record";
+    }
+    return "unknown";
+}
+
+// Specialized for every record type with a `value` tuple of Field descriptors in file order. All binary and JSON
+// serializers below are instantiated from these tables.
+template <typename T>
+struct Fields;
+
+template <typename T>
+concept Record = requires { Fields<T>::value; };
+
+template <typename M>
+constexpr WireKind WireKindOf() {
+    if constexpr (std::is_same_v<M, Integer>) {
+        return WireKind::Integer;
+    } else if constexpr (std::is_same_v<M, Float>) {
+        return WireKind::Float;
+    } else if constexpr (std::is_same_v<M, Boolean>) {
+        return WireKind::Boolean;
+    } else if constexpr (std::is_same_v<M, HexString>) {
+        return WireKind::HexString;
+    } else if constexpr (std::is_same_v<M, String>) {
+        return WireKind::String;
+    } else if constexpr (IsArray<M>) {
+        return WireKind::Array;
+    } else if constexpr (IsFixedArray<M>) {
+        return WireKind::FixedArray;
+    } else {
+        static_assert(Record<M>, "Member type has no wire representation");
+        return WireKind::Record;
+    }
+}
+
+// Describes one serialized member of a record: its JSON key, where it lives in the class and its wire kind.
+template <typename Class, typename Member>
+struct Field {
+    using class_type = Class;
+    using member_type = Member;
+
+    constexpr Field(std::string_view name, Member Class::*member) : name{name}, member{member} {}
+
+    std::string_view name;
+    Member Class::*member;
+    static constexpr WireKind kind = WireKindOf<Member>();
+};
+
+// Shorthand for declaring a Field inside a Fields<T> specialization that defines `using T = ...`
+#define EVO_FIELD(member) ::Evo::Field(#member, &T::member)
+
+template <typename T>
+constexpr size_t FieldCount = std::tuple_size_v<std::remove_cvref_t<decltype(Fields<T>::value)>>;
+
+template <typename T, size_t I>
+using FieldType = typename std::tuple_element_t<I, std::remove_cvref_t<decltype(Fields<T>::value)>>::member_type;
+
+// Calls fn(std::integral_constant<size_t, I>, field) for every field of T in declaration order.
+template <typename T, typename F>
+constexpr void ForEachField(F&& fn) {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (fn(std::integral_constant<size_t, I>{}, std::get<I>(Fields<T>::value)), ...);
+    }(std::make_index_sequence<FieldCount<T>>{});
+}
+
+template <typename T>
+constexpr auto FieldNames() {
+    return []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<std::string_view, sizeof...(I)>{std::get<I>(Fields<T>::value).name...};
+    }(std::make_index_sequence<FieldCount<T>>{});
+}
+
+// Maps a field name of T to the index of the field, for dispatching the keys of a JSON object.
+template <typename T>
+constexpr Common::PerfectHash<FieldCount<T>> FieldIndex{FieldNames<T>()};
+
+// Size of T on disk when it does not depend on the contents, 0 when it does (strings and arrays).
+template <typename T>
+constexpr size_t FixedWireSize() {
+    if constexpr (std::is_same_v<T, Integer> || std::is_same_v<T, Float> || std::is_same_v<T, Boolean>) {
+        return sizeof(s32);
+    } else if constexpr (IsFixedArray<T>) {
+        return FixedWireSize<typename T::value_type>() * T::count;
+    } else if constexpr (Record<T>) {
+        return []<size_t... I>(std::index_sequence<I...>) -> size_t {
+            const bool all_fixed = ((FixedWireSize<FieldType<T, I>>() != 0) && ...);
+            return all_fixed ? (FixedWireSize<FieldType<T, I>>() + ...) : 0;
+        }(std::make_index_sequence<FieldCount<T>>{});
+    } else {
+        return 0;
+    }
+}
+
+// True when the in-memory object is exactly its wire bytes (in host order), so arrays of it can be block copied.
+// Records whose layout matches the wire format opt in with a specialization next to their Fields table.
+template <typename T>
+constexpr bool HasWireLayout = std::is_same_v<T, Integer> || std::is_same_v<T, Float> || std::is_same_v<T, Boolean>;
+
+// Consecutive fixed-size fields form a run that is bounds checked once and then decoded straight from memory.
+// Returns the byte size of the run starting at field I, or 0 if field I does not start one.
+template <typename T, size_t I>
+constexpr size_t FixedRunSize() {
+    constexpr auto sizes = []<size_t... J>(std::index_sequence<J...>) {
+        return std::array<size_t, sizeof...(J)>{FixedWireSize<FieldType<T, J>>()...};
+    }(std::make_index_sequence<FieldCount<T>>{});
+    if (sizes[I] == 0 || (I > 0 && sizes[I - 1] != 0)) {
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = I; i < sizes.size() && sizes[i] != 0; i++) {
+        total += sizes[i];
+    }
+    return total;
+}
+
+// Runs t.Validate(). Problems go to the diagnostics sink when there is one, located lazily through location(), which
+// gives a description or an offset into the JSON text; otherwise warnings are logged and errors thrown.
+template <typename T, typename Location>
+void ValidateRecord(const T& t, Common::Diagnostics* diagnostics, Location&& location) {
+    try {
+        t.Validate();
+    } catch (const Common::ValidationError& e) {
+        if (diagnostics) {
+            diagnostics->Report(e.severity, location(), e.what());
+        } else if (e.severity == Common::Severity::Warning) {
+            LOG_WARNING("{}", e.what());
+        } else {
+            throw;
+        }
+    }
+}
+template <typename T>
+void ValidateRecord(const T& t) {
+    ValidateRecord(t, nullptr, [] { return std::string(); });
+}
+
+inline void DecodeFixed(const char*& p, Integer& i) {
+    i.data = Common::LoadLE<s32>(p);
+    p += sizeof(s32);
+}
+
+inline void DecodeFixed(const char*& p, Boolean& b) {
+    b.data = Common::LoadLE<s32>(p);
+    p += sizeof(s32);
+}
+
+inline void DecodeFixed(const char*& p, Float& f) {
+    f.data = std::bit_cast<f32>(Common::LoadLE<u32>(p));
+    p += sizeof(u32);
+}
+
+template <typename T, s32 size>
+void DecodeFixed(const char*& p, FixedArray<T, size>& a) {
+    if constexpr (HasWireLayout<T>) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) == FixedWireSize<T>());
+        constexpr size_t words = size * sizeof(T) / sizeof(u32);
+        Common::LoadLE32Block(a.data.data(), p, words);
+        p += words * sizeof(u32);
+    } else {
+        for (T& item : a.data) {
+            DecodeFixed(p, item);
+        }
+    }
+}
+
+template <Record T>
+    requires(FixedWireSize<T>() != 0)
+void DecodeFixed(const char*& p, T& t) {
+    ForEachField<T>([&](auto, const auto& field) { DecodeFixed(p, t.*field.member); });
+    ValidateRecord(t);
+}
+
+inline void EncodeFixed(char*& p, const Integer& i) {
+    Common::StoreLE<s32>(p, i.data);
+    p += sizeof(s32);
+}
+
+inline void EncodeFixed(char*& p, const Boolean& b) {
+    Common::StoreLE<s32>(p, b.data);
+    p += sizeof(s32);
+}
+
+inline void EncodeFixed(char*& p, const Float& f) {
+    Common::StoreLE<u32>(p, std::bit_cast<u32>(f.data));
+    p += sizeof(u32);
+}
+
+template <typename T, s32 size>
+void EncodeFixed(char*& p, const FixedArray<T, size>& a) {
+    if constexpr (HasWireLayout<T>) {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) == FixedWireSize<T>());
+        constexpr size_t words = size * sizeof(T) / sizeof(u32);
+        Common::StoreLE32Block(p, a.data.data(), words);
+        p += words * sizeof(u32);
+    } else {
+        for (const T& item : a.data) {
+            EncodeFixed(p, item);
+        }
+    }
+}
+
+template <Record T>
+    requires(FixedWireSize<T>() != 0)
+void EncodeFixed(char*& p, const T& t) {
+    ValidateRecord(t);
+    ForEachField<T>([&](auto, const auto& field) { EncodeFixed(p, t.*field.member); });
+}
+
+template <Record T>
+Common::BinaryReader& operator>>(Common::BinaryReader& r, T& t) {
+    const size_t start = r.Offset();
+    const char* run = nullptr;
+    ForEachField<T>([&](auto index, const auto& field) {
+        using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+        if constexpr (FixedWireSize<M>() != 0) {
+            if constexpr (FixedRunSize<T, decltype(index)::value>() != 0) {
+                run = r.Take(FixedRunSize<T, decltype(index)::value>());
+            }
+            DecodeFixed(run, t.*field.member);
+        } else {
+            r >> t.*field.member;
+        }
+    });
+    ValidateRecord(t, r.GetDiagnostics(), [&] { return fmt::format("offset {:#x}", start); });
+    return r;
+}
+
+template <Record T>
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const T& t) {
+    ValidateRecord(t);
+    char* run = nullptr;
+    ForEachField<T>([&](auto index, const auto& field) {
+        using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+        if constexpr (FixedWireSize<M>() != 0) {
+            if constexpr (FixedRunSize<T, decltype(index)::value>() != 0) {
+                run = w.Take(FixedRunSize<T, decltype(index)::value>());
+            }
+            EncodeFixed(run, t.*field.member);
+        } else {
+            w << t.*field.member;
+        }
+    });
+    return w;
+}
+
+template <Record T>
+size_t BinarySize(const T& t) {
+    if constexpr (FixedWireSize<T>() != 0) {
+        return FixedWireSize<T>();
+    } else {
+        size_t size = 0;
+        ForEachField<T>([&](auto, const auto& field) {
+            using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+            if constexpr (FixedWireSize<M>() != 0) {
+                size += FixedWireSize<M>();
+            } else {
+                size += BinarySize(t.*field.member);
+            }
+        });
+        return size;
+    }
+}
+
+// Moves r past one encoded T without decoding it, with the same bounds checks decoding would make. Fixed-size
+// stretches are hopped over in one step, so only the string lengths are actually read.
+template <typename T>
+void SkipBinary(Common::BinaryReader& r) {
+    if constexpr (FixedWireSize<T>() != 0) {
+        r.Take(FixedWireSize<T>());
+    } else if constexpr (std::is_base_of_v<String, T>) {
+        const s32 len = r.Read<s32>();
+        if (len < 0) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Invalid string length {} at offset {:#x}", len, r.Offset() - 4));
+        }
+        r.Take(len);
+    } else if constexpr (IsFixedArray<T>) {
+        for (s32 i = 0; i < T::count; i++) {
+            SkipBinary<typename T::value_type>(r);
+        }
+    } else if constexpr (IsArray<T>) {
+        // A whole section, as a reader skips the sections it was not asked for
+        SkipBinary<String>(r);
+        const s32 size = r.Read<s32>();
+        if (size < 0 || static_cast<size_t>(size) > r.Remaining()) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Invalid array size {} at offset {:#x}", size, r.Offset() - 4));
+        }
+        for (s32 i = 0; i < size; i++) {
+            SkipBinary<typename T::value_type>(r);
+        }
+    } else {
+        static_assert(Record<T>, "Member type has no wire representation");
+        ForEachField<T>([&](auto index, const auto& field) {
+            using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+            if constexpr (FixedWireSize<M>() != 0) {
+                if constexpr (FixedRunSize<T, decltype(index)::value>() != 0) {
+                    r.Take(FixedRunSize<T, decltype(index)::value>());
+                }
+            } else {
+                SkipBinary<M>(r);
+            }
+        });
+    }
+}
+
+// Calls fn(String&) for every string in t, HexStrings included.
+template <typename T, typename F>
+void ForEachString(T& t, F&& fn) {
+    if constexpr (std::is_base_of_v<String, T>) {
+        fn(static_cast<String&>(t));
+    } else if constexpr (IsArray<T>) {
+        fn(t.name);
+        for (auto& item : t.data) {
+            ForEachString(item, fn);
+        }
+    } else if constexpr (IsFixedArray<T>) {
+        for (auto& item : t.data) {
+            ForEachString(item, fn);
+        }
+    } else if constexpr (Record<T>) {
+        ForEachField<T>([&](auto, const auto& field) { ForEachString(t.*field.member, fn); });
+    }
+}
+
+template <typename T>
+using JsonFieldReader = void (*)(Common::JsonReader&, T&);
+
+// Reads one JSON object into t, dispatching each key to the reader of the field with the same name.
+// Unknown keys are skipped, with a warning when there are diagnostics; missing ones are an error. With diagnostics
+// every bad field and every missing key is reported, rather than only the first.
+template <typename T, size_t N>
+void ReadJsonFields(Common::JsonReader& r, T& t, const std::array<std::string_view, N>& names,
+                    const Common::PerfectHash<N>& index, const std::array<JsonFieldReader<T>, N>& readers) {
+    const size_t start = r.Offset();
+    std::array<bool, N> seen{};
+    // Documents written by this tool have the keys in field order, so the key after field i is almost always field
+    // i + 1 and one compare finds it. Reordered keys take one hash lookup each.
+    size_t expected = 0;
+    r.ReadObject([&](std::string_view key) {
+        size_t i = expected;
+        if (i >= N || names[i] != key) [[unlikely]] {
+            i = index.Find(key);
+            if (i == index.NotFound) {
+                if (r.GetDiagnostics()) {
+                    r.GetDiagnostics()->Report(Common::Severity::Warning, r.Offset(), "Ignoring unknown key");
+                }
+                r.SkipValue();
+                return;
+            }
+        }
+        expected = i + 1;
+        r.ReadRecoverable([&] { readers[i](r, t); });
+        seen[i] = true;
+    });
+    for (size_t i = 0; i < N; i++) {
+        if (!seen[i]) [[unlikely]] {
+            if (!r.GetDiagnostics()) {
+                r.Error(fmt::format("Missing key '{}'", names[i]));
+            }
+            r.GetDiagnostics()->Report(Common::Severity::Error, start, fmt::format("Missing key '{}'", names[i]));
+        }
+    }
+}
+
+template <Record T>
+Common::JsonReader& operator>>(Common::JsonReader& r, T& t) {
+    static constexpr auto names = FieldNames<T>();
+    static constexpr auto readers = []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<JsonFieldReader<T>, sizeof...(I)>{
+            [](Common::JsonReader& r, T& t) { r >> t.*std::get<I>(Fields<T>::value).member; }...};
+    }(std::make_index_sequence<FieldCount<T>>{});
+    const size_t start = r.Offset();
+    ReadJsonFields(r, t, names, FieldIndex<T>, readers);
+    ValidateRecord(t, r.GetDiagnostics(), [&] { return start; });
+    return r;
+}
+
+template <Record T>
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const T& t) {
+    ValidateRecord(t);
+    w.BeginObject();
+    ForEachField<T>([&](auto, const auto& field) { w.Key(field.name) << t.*field.member; });
+    w.EndObject();
+    return w;
+}
+
+template <typename BasicJsonType, Record T>
+    requires nlohmann::detail::is_basic_json<BasicJsonType>::value
+void to_json(BasicJsonType& j, const T& t) {
+    ValidateRecord(t);
+    ForEachField<T>([&](auto, const auto& field) { j[std::string(field.name)] = t.*field.member; });
+}
+
+template <typename BasicJsonType, Record T>
+    requires nlohmann::detail::is_basic_json<BasicJsonType>::value
+void from_json(const BasicJsonType& j, T& t) {
+    // One pass over the members, each key dispatched through the field index, instead of a search of the object
+    // for every field
+    using FieldReader = void (*)(const BasicJsonType&, T&);
+    static constexpr auto readers = []<size_t... I>(std::index_sequence<I...>) {
+        return std::array<FieldReader, sizeof...(I)>{
+            [](const BasicJsonType& j, T& t) { j.get_to(t.*std::get<I>(Fields<T>::value).member); }...};
+    }(std::make_index_sequence<FieldCount<T>>{});
+    if (!j.is_object()) [[unlikely]] {
+        throw std::runtime_error(fmt::format("Expected 'object', got '{}'", j.type_name()));
     }
+    std::array<bool, FieldCount<T>> seen{};
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        const size_t i = FieldIndex<T>.Find(it.key());
+        if (i != FieldIndex<T>.NotFound) {
+            readers[i](it.value(), t);
+            seen[i] = true;
+        }
+    }
+    for (size_t i = 0; i < seen.size(); i++) {
+        if (!seen[i]) [[unlikely]] {
+            throw std::out_of_range(fmt::format("Missing key '{}'", FieldNames<T>()[i]));
+        }
+    }
+    ValidateRecord(t);
+}
+
+} // namespace Evo
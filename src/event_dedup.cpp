@@ -0,0 +1,108 @@
+#include "event_dedup.h"
+
+namespace Evo {
+
+DedupedEvents::DedupedEvents(const DcTour& tour) : name{tour.events.name}, backing{tour.backing} {
+    rows.reserve(tour.events.data.size());
+    for (const Event& event : tour.events.data) {
+        Row& row = rows.emplace_back();
+        ForEachField<Event>([&](auto index, const auto& field) {
+            constexpr size_t I = decltype(index)::value;
+            if constexpr (IsFixedArray<FieldType<Event, I>>) {
+                std::get<I>(row) = std::get<I>(pools).Intern(event.*field.member);
+            } else {
+                std::get<I>(row) = event.*field.member;
+            }
+        });
+    }
+}
+
+Event DedupedEvents::Borrowed(size_t index) const {
+    const Row& row = rows[index];
+    Event event;
+    ForEachField<Event>([&](auto i, const auto& field) {
+        constexpr size_t I = decltype(i)::value;
+        if constexpr (IsFixedArray<FieldType<Event, I>>) {
+            event.*field.member = std::get<I>(pools)[std::get<I>(row)];
+        } else {
+            event.*field.member = std::get<I>(row);
+        }
+    });
+    return event;
+}
+
+Event DedupedEvents::Get(size_t index) const {
+    Event event = Borrowed(index);
+    ForEachString(event, [](String& s) { s.Assign(s.view()); });
+    return event;
+}
+
+void DedupedEvents::Restore(DcTour& tour) const {
+    Array<Event>& events = tour.events;
+    events.name = name;
+    events.data.clear();
+    events.data.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        events.data.push_back(Borrowed(i));
+    }
+    events.size.data = static_cast<s32>(rows.size());
+    if (backing != nullptr && tour.backing != backing) {
+        // The tour's other sections may still borrow from its own backing, so it has to hold on to both
+        using Both = std::pair<std::shared_ptr<const void>, std::shared_ptr<const void>>;
+        tour.backing = std::make_shared<const Both>(std::move(tour.backing), backing);
+    }
+}
+
+u64 DedupedEvents::Hash(size_t index) const {
+    const Row& row = rows[index];
+    u64 h = 0;
+    ForEachField<Event>([&](auto i, const auto&) {
+        constexpr size_t I = decltype(i)::value;
+        if constexpr (IsFixedArray<FieldType<Event, I>>) {
+            // The pool already hashed the block's contents
+            h = MixHash(h, std::get<I>(pools).Hash(std::get<I>(row)));
+        } else {
+            h = MixHash(h, HashValue(std::get<I>(row)));
+        }
+    });
+    return h;
+}
+
+bool DedupedEvents::SameEvent(size_t a, size_t b) const {
+    const Row& x = rows[a];
+    const Row& y = rows[b];
+    bool same = true;
+    ForEachField<Event>([&](auto i, const auto&) {
+        constexpr size_t I = decltype(i)::value;
+        if constexpr (IsFixedArray<FieldType<Event, I>>) {
+            same = same && std::get<I>(x) == std::get<I>(y);
+        } else {
+            same = same && SameValue(std::get<I>(x), std::get<I>(y));
+        }
+    });
+    return same;
+}
+
+size_t DedupedEvents::UniqueBlocks() const {
+    size_t count = 0;
+    ForEachField<Event>([&](auto i, const auto&) {
+        constexpr size_t I = decltype(i)::value;
+        if constexpr (IsFixedArray<FieldType<Event, I>>) {
+            count += std::get<I>(pools).Size();
+        }
+    });
+    return count;
+}
+
+size_t DedupedEvents::MemoryBytes() const {
+    size_t bytes = rows.capacity() * sizeof(Row);
+    ForEachField<Event>([&](auto i, const auto&) {
+        constexpr size_t I = decltype(i)::value;
+        if constexpr (IsFixedArray<FieldType<Event, I>>) {
+            bytes += std::get<I>(pools).MemoryBytes();
+        }
+    });
+    return bytes;
+}
+
+} // namespace Evo
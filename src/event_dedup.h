@@ -0,0 +1,182 @@
+#pragma once
+
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "common/flat_index.h"
+#include "conversion.h"
+#include "tours.h"
+
+namespace Evo {
+
+inline u64 MixHash(u64 h, u64 v) {
+    h = (h ^ v) * 0x9E3779B97F4A7C15ull;
+    return h ^ (h >> 32);
+}
+
+// Content hash of any serialized value. Floats hash by their bits, so values that compare equal but are written
+// differently (0.0 and -0.0) stay apart, as SameValue requires.
+template <typename T>
+u64 HashValue(const T& t) {
+    if constexpr (HasWireLayout<T>) {
+        return Common::HashKey(std::string_view(reinterpret_cast<const char*>(&t), sizeof(T)));
+    } else if constexpr (std::is_base_of_v<String, T>) {
+        return Common::HashKey(t.view());
+    } else if constexpr (IsFixedArray<T>) {
+        if constexpr (HasWireLayout<typename T::value_type>) {
+            return Common::HashKey(std::string_view(reinterpret_cast<const char*>(t.data.data()), sizeof(t.data)));
+        } else {
+            u64 h = 0;
+            for (const auto& item : t.data) {
+                h = MixHash(h, HashValue(item));
+            }
+            return h;
+        }
+    } else {
+        static_assert(Record<T>, "Only single values, fixed arrays and records can be hashed");
+        u64 h = 0;
+        ForEachField<T>([&](auto, const auto& field) { h = MixHash(h, HashValue(t.*field.member)); });
+        return h;
+    }
+}
+
+// True when a and b serialize to the same bytes.
+template <typename T>
+bool SameValue(const T& a, const T& b) {
+    if constexpr (HasWireLayout<T>) {
+        return std::memcmp(&a, &b, sizeof(T)) == 0;
+    } else if constexpr (std::is_base_of_v<String, T>) {
+        return a == b;
+    } else if constexpr (IsFixedArray<T>) {
+        if constexpr (HasWireLayout<typename T::value_type>) {
+            return std::memcmp(a.data.data(), b.data.data(), sizeof(a.data)) == 0;
+        } else {
+            for (size_t i = 0; i < a.data.size(); i++) {
+                if (!SameValue(a.data[i], b.data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    } else {
+        static_assert(Record<T>, "Only single values, fixed arrays and records can be compared");
+        bool same = true;
+        ForEachField<T>([&](auto, const auto& field) { same = same && SameValue(a.*field.member, b.*field.member); });
+        return same;
+    }
+}
+
+// Stores one copy of every distinct block it is given and hands out a dense id per copy. Blocks are found by their
+// content hash and then compared in full, so two blocks share an id exactly when they serialize the same.
+template <typename T>
+class BlockPool {
+public:
+    u32 Intern(const T& block) {
+        const u64 hash = HashValue(block);
+        if (slots.size() < (blocks.size() + 1) * 2) {
+            Rehash(std::bit_ceil(std::max<size_t>((blocks.size() + 1) * 4, 16)));
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (slots[i] == Empty) {
+                slots[i] = static_cast<u32>(blocks.size());
+                blocks.push_back(block);
+                hashes.push_back(hash);
+                return slots[i];
+            }
+            if (hashes[slots[i]] == hash && SameValue(blocks[slots[i]], block)) {
+                return slots[i];
+            }
+        }
+    }
+
+    const T& operator[](u32 id) const {
+        return blocks[id];
+    }
+    u64 Hash(u32 id) const {
+        return hashes[id];
+    }
+    size_t Size() const {
+        return blocks.size();
+    }
+    size_t MemoryBytes() const {
+        return blocks.capacity() * sizeof(T) + hashes.capacity() * sizeof(u64) + slots.capacity() * sizeof(u32);
+    }
+
+private:
+    static constexpr u32 Empty = ~0u;
+
+    void Rehash(size_t size) {
+        slots.assign(size, Empty);
+        for (u32 id = 0; id < blocks.size(); id++) {
+            size_t i = hashes[id] & (size - 1);
+            while (slots[i] != Empty) {
+                i = (i + 1) & (size - 1);
+            }
+            slots[i] = id;
+        }
+    }
+
+    std::vector<T> blocks;
+    std::vector<u64> hashes;
+    std::vector<u32> slots;
+};
+
+// Events with the fixed-size blocks (objectives, extra star requirements, AI grid, fame table) hash-consed: tours
+// repeat the same few blocks across thousands of events, so each distinct block is stored once in a pool and every
+// event keeps only its id. The conversion back is exact. Equal blocks have equal ids, which makes hashing and
+// comparing whole events much cheaper than on the full records.
+class DedupedEvents {
+public:
+    // A FixedArray field of Event becomes an id into its pool; every other field is stored as is
+    template <typename M>
+    using Column = std::conditional_t<IsFixedArray<M>, u32, M>;
+    template <typename M>
+    using Pool = std::conditional_t<IsFixedArray<M>, BlockPool<M>, std::monostate>;
+
+    using Row = decltype([]<size_t... I>(std::index_sequence<I...>) {
+        return std::tuple<Column<FieldType<Event, I>>...>{};
+    }(std::make_index_sequence<FieldCount<Event>>{}));
+    using Pools = decltype([]<size_t... I>(std::index_sequence<I...>) {
+        return std::tuple<Pool<FieldType<Event, I>>...>{};
+    }(std::make_index_sequence<FieldCount<Event>>{}));
+
+    DedupedEvents() = default;
+    // Keeps the tour's backing alive, since the strings of the rows may borrow from it
+    explicit DedupedEvents(const DcTour& tour);
+
+    size_t Size() const {
+        return rows.size();
+    }
+    // The event's strings are its own copies, so it may outlive this object
+    Event Get(size_t index) const;
+    // Writes the events back in their original form into tour.events, e.g. before saving. The strings still borrow
+    // from the source tour's backing, which tour then keeps alive along with its own.
+    void Restore(DcTour& tour) const;
+
+    // Hash of a whole event, the same for any two events that SameEvent considers equal
+    u64 Hash(size_t index) const;
+    bool SameEvent(size_t a, size_t b) const;
+
+    // Distinct blocks over all pools
+    size_t UniqueBlocks() const;
+    // Approximate heap footprint of the rows and pools, not counting strings
+    size_t MemoryBytes() const;
+
+private:
+    String name;
+    Event Borrowed(size_t index) const;
+
+    std::vector<Row> rows;
+    Pools pools;
+    std::shared_ptr<const void> backing;
+};
+
+} // namespace Evo
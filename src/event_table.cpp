@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "event_table.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EVENT_TABLE_USE_SSE2
+#endif
+
+namespace Evo {
+
+EventTable::EventTable(const Array<Event>& events) : size{events.data.size()} {
+    ForEachField<Event>([&](auto index, const auto& field) {
+        constexpr WireKind kind = std::remove_cvref_t<decltype(field)>::kind;
+        if constexpr (kind != WireKind::FixedArray) {
+            columns[index].kind = kind;
+            columns[index].words.resize(size);
+        }
+    });
+    // Row by row, so every event is read from memory once
+    for (size_t row = 0; row < size; row++) {
+        const Event& event = events.data[row];
+        ForEachField<Event>([&](auto index, const auto& field) {
+            const auto& value = event.*field.member;
+            using M = std::remove_cvref_t<decltype(value)>;
+            if constexpr (std::is_base_of_v<String, M>) {
+                columns[index].words[row] = strings.InternId(value.view());
+            } else if constexpr (HasWireLayout<M>) {
+                columns[index].words[row] = std::bit_cast<u32>(value.data);
+            }
+        });
+    }
+}
+
+size_t EventTable::ColumnIndex(std::string_view field) const {
+    const size_t index = FieldIndex<Event>.Find(field);
+    return index != FieldIndex<Event>.NotFound && columns[index].kind != WireKind::FixedArray ? index : NotFound;
+}
+
+const EventTable::Column& EventTable::CheckedColumn(size_t column, WireKind kind) const {
+    const Column& c = columns[column];
+    // Booleans are stored and compared as the integers they are on disk
+    const bool matches = c.kind == kind || (kind == WireKind::Integer && c.kind == WireKind::Boolean) ||
+                         (kind == WireKind::String && c.kind == WireKind::HexString);
+    if (!matches) [[unlikely]] {
+        throw std::invalid_argument(
+            fmt::format("Column '{}' holds {} values, not {}", ColumnName(column), KindName(c.kind), KindName(kind)));
+    }
+    return c;
+}
+
+s32 EventTable::GetInt(size_t column, size_t row) const {
+    return static_cast<s32>(CheckedColumn(column, WireKind::Integer).words[row]);
+}
+f32 EventTable::GetFloat(size_t column, size_t row) const {
+    return std::bit_cast<f32>(CheckedColumn(column, WireKind::Float).words[row]);
+}
+std::string_view EventTable::GetString(size_t column, size_t row) const {
+    return strings[CheckedColumn(column, WireKind::String).words[row]];
+}
+void EventTable::SetInt(size_t column, size_t row, s32 value) {
+    CheckedColumn(column, WireKind::Integer).words[row] = static_cast<u32>(value);
+}
+void EventTable::SetFloat(size_t column, size_t row, f32 value) {
+    CheckedColumn(column, WireKind::Float).words[row] = std::bit_cast<u32>(value);
+}
+void EventTable::SetString(size_t column, size_t row, std::string_view value) {
+    Column& c = CheckedColumn(column, WireKind::String);
+    c.words[row] = strings.InternId(value);
+}
+
+template <Compare op, typename T>
+static bool Holds(T value, T operand) {
+    if constexpr (op == Compare::Equal) {
+        return value == operand;
+    } else if constexpr (op == Compare::NotEqual) {
+        return value != operand;
+    } else if constexpr (op == Compare::Less) {
+        return value < operand;
+    } else if constexpr (op == Compare::LessEqual) {
+        return value <= operand;
+    } else if constexpr (op == Compare::Greater) {
+        return value > operand;
+    } else {
+        return value >= operand;
+    }
+}
+
+#ifdef EVENT_TABLE_USE_SSE2
+// One bit per lane of four 32-bit compares
+template <Compare op>
+static u32 HoldsLanes(__m128i value, __m128i operand) {
+    __m128i mask;
+    if constexpr (op == Compare::Equal || op == Compare::NotEqual) {
+        mask = _mm_cmpeq_epi32(value, operand);
+    } else if constexpr (op == Compare::Less || op == Compare::GreaterEqual) {
+        mask = _mm_cmplt_epi32(value, operand);
+    } else {
+        mask = _mm_cmpgt_epi32(value, operand);
+    }
+    const u32 lanes = _mm_movemask_ps(_mm_castsi128_ps(mask));
+    // SSE2 has no integer not-equal, less-equal or greater-equal; they are the complements of the others
+    constexpr bool negate = op == Compare::NotEqual || op == Compare::LessEqual || op == Compare::GreaterEqual;
+    return negate ? ~lanes & 0xF : lanes;
+}
+template <Compare op>
+static u32 HoldsLanes(__m128 value, __m128 operand) {
+    if constexpr (op == Compare::Equal) {
+        return _mm_movemask_ps(_mm_cmpeq_ps(value, operand));
+    } else if constexpr (op == Compare::NotEqual) {
+        return _mm_movemask_ps(_mm_cmpneq_ps(value, operand));
+    } else if constexpr (op == Compare::Less) {
+        return _mm_movemask_ps(_mm_cmplt_ps(value, operand));
+    } else if constexpr (op == Compare::LessEqual) {
+        return _mm_movemask_ps(_mm_cmple_ps(value, operand));
+    } else if constexpr (op == Compare::Greater) {
+        return _mm_movemask_ps(_mm_cmpgt_ps(value, operand));
+    } else {
+        return _mm_movemask_ps(_mm_cmpge_ps(value, operand));
+    }
+}
+#endif
+
+// Clears the bit of every row whose value fails the compare. Words with no rows left are skipped.
+template <Compare op, typename T>
+static void FilterWords(const std::vector<u32>& words, T operand, RowSet& rows) {
+    std::vector<u64>& bits = rows.Words();
+#ifdef EVENT_TABLE_USE_SSE2
+    __m128i lanes_operand;
+    if constexpr (std::is_same_v<T, f32>) {
+        lanes_operand = _mm_castps_si128(_mm_set1_ps(operand));
+    } else {
+        lanes_operand = _mm_set1_epi32(operand);
+    }
+#endif
+    for (size_t w = 0; w < bits.size(); w++) {
+        if (bits[w] == 0) {
+            continue;
+        }
+        const size_t base = w * 64;
+        const size_t end = std::min(words.size(), base + 64);
+        u64 matches = 0;
+        size_t i = base;
+#ifdef EVENT_TABLE_USE_SSE2
+        for (; i + 4 <= end; i += 4) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words.data() + i));
+            u32 lanes;
+            if constexpr (std::is_same_v<T, f32>) {
+                lanes = HoldsLanes<op>(_mm_castsi128_ps(value), _mm_castsi128_ps(lanes_operand));
+            } else {
+                lanes = HoldsLanes<op>(value, lanes_operand);
+            }
+            matches |= static_cast<u64>(lanes) << (i - base);
+        }
+#endif
+        for (; i < end; i++) {
+            matches |= static_cast<u64>(Holds<op>(std::bit_cast<T>(words[i]), operand)) << (i - base);
+        }
+        bits[w] &= matches;
+    }
+}
+
+template <typename T>
+static void FilterWords(const std::vector<u32>& words, Compare op, T operand, RowSet& rows) {
+    switch (op) {
+    case Compare::Equal:
+        return FilterWords<Compare::Equal>(words, operand, rows);
+    case Compare::NotEqual:
+        return FilterWords<Compare::NotEqual>(words, operand, rows);
+    case Compare::Less:
+        return FilterWords<Compare::Less>(words, operand, rows);
+    case Compare::LessEqual:
+        return FilterWords<Compare::LessEqual>(words, operand, rows);
+    case Compare::Greater:
+        return FilterWords<Compare::Greater>(words, operand, rows);
+    case Compare::GreaterEqual:
+        return FilterWords<Compare::GreaterEqual>(words, operand, rows);
+    }
+}
+
+void EventTable::Filter(RowSet& rows, size_t column, Compare op, s32 operand) const {
+    FilterWords(CheckedColumn(column, WireKind::Integer).words, op, operand, rows);
+}
+
+void EventTable::Filter(RowSet& rows, size_t column, Compare op, f32 operand) const {
+    FilterWords(CheckedColumn(column, WireKind::Float).words, op, operand, rows);
+}
+
+void EventTable::Filter(RowSet& rows, size_t column, Compare op, std::string_view operand) const {
+    const Column& c = CheckedColumn(column, WireKind::String);
+    if (op != Compare::Equal && op != Compare::NotEqual) {
+        throw std::invalid_argument(fmt::format("Strings in column '{}' can only be compared for equality",
+                                                ColumnName(column)));
+    }
+    const u32 code = strings.Find(operand);
+    if (code == Common::StringPool::NotFound) {
+        // No row holds the string
+        if (op == Compare::Equal) {
+            rows = RowSet(size, false);
+        }
+        return;
+    }
+    // Codes are compared for equality only, for which their sign does not matter
+    FilterWords(c.words, op, static_cast<s32>(code), rows);
+}
+
+// Adds the values of one fully selected word of rows, 64 values, to the running sums.
+template <typename T>
+static void SummarizeBlock(const u32* words, f64& sum, T& min, T& max) {
+#ifdef EVENT_TABLE_USE_SSE2
+    if constexpr (std::is_same_v<T, f32>) {
+        __m128d sums = _mm_setzero_pd();
+        __m128 mins = _mm_set1_ps(min), maxs = _mm_set1_ps(max);
+        for (size_t i = 0; i < 64; i += 4) {
+            const __m128 value = _mm_loadu_ps(reinterpret_cast<const f32*>(words + i));
+            sums = _mm_add_pd(sums, _mm_add_pd(_mm_cvtps_pd(value), _mm_cvtps_pd(_mm_movehl_ps(value, value))));
+            mins = _mm_min_ps(mins, value);
+            maxs = _mm_max_ps(maxs, value);
+        }
+        alignas(16) f64 s[2];
+        alignas(16) f32 lo[4], hi[4];
+        _mm_store_pd(s, sums);
+        _mm_store_ps(lo, mins);
+        _mm_store_ps(hi, maxs);
+        sum += s[0] + s[1];
+        min = std::min({lo[0], lo[1], lo[2], lo[3]});
+        max = std::max({hi[0], hi[1], hi[2], hi[3]});
+    } else {
+        // Integer sums are exact: each value is widened to 64 bits before it is added
+        __m128i sums = _mm_setzero_si128();
+        __m128i mins = _mm_set1_epi32(min), maxs = _mm_set1_epi32(max);
+        for (size_t i = 0; i < 64; i += 4) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+            const __m128i sign = _mm_srai_epi32(value, 31);
+            sums = _mm_add_epi64(sums, _mm_add_epi64(_mm_unpacklo_epi32(value, sign), _mm_unpackhi_epi32(value, sign)));
+            // SSE2 has no 32-bit min and max, so they are selected through a compare mask
+            const __m128i less = _mm_cmplt_epi32(value, mins);
+            mins = _mm_or_si128(_mm_and_si128(less, value), _mm_andnot_si128(less, mins));
+            const __m128i greater = _mm_cmpgt_epi32(value, maxs);
+            maxs = _mm_or_si128(_mm_and_si128(greater, value), _mm_andnot_si128(greater, maxs));
+        }
+        alignas(16) s64 s[2];
+        alignas(16) s32 lo[4], hi[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(s), sums);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lo), mins);
+        _mm_store_si128(reinterpret_cast<__m128i*>(hi), maxs);
+        sum += static_cast<f64>(s[0] + s[1]);
+        min = std::min({lo[0], lo[1], lo[2], lo[3]});
+        max = std::max({hi[0], hi[1], hi[2], hi[3]});
+    }
+#else
+    s64 int_sum = 0;
+    for (size_t i = 0; i < 64; i++) {
+        const T value = std::bit_cast<T>(words[i]);
+        if constexpr (std::is_same_v<T, f32>) {
+            sum += value;
+        } else {
+            int_sum += value;
+        }
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    sum += static_cast<f64>(int_sum);
+#endif
+}
+
+template <typename T>
+static ColumnSummary SummarizeWords(const std::vector<u32>& words, const RowSet& rows) {
+    ColumnSummary summary;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+    const std::vector<u64>& bits = rows.Words();
+    for (size_t w = 0; w < bits.size(); w++) {
+        if (bits[w] == ~u64{0}) {
+            SummarizeBlock(words.data() + w * 64, summary.sum, min, max);
+            summary.count += 64;
+            continue;
+        }
+        for (u64 word = bits[w]; word != 0; word &= word - 1) {
+            const T value = std::bit_cast<T>(words[w * 64 + std::countr_zero(word)]);
+            summary.sum += static_cast<f64>(value);
+            min = std::min(min, value);
+            max = std::max(max, value);
+            summary.count++;
+        }
+    }
+    if (summary.count > 0) {
+        summary.min = min;
+        summary.max = max;
+    }
+    return summary;
+}
+
+ColumnSummary EventTable::Summarize(size_t column, const RowSet& rows) const {
+    const Column& c = columns[column];
+    if (c.kind == WireKind::Float) {
+        return SummarizeWords<f32>(c.words, rows);
+    }
+    return SummarizeWords<s32>(CheckedColumn(column, WireKind::Integer).words, rows);
+}
+
+void EventTable::WriteBack(Array<Event>& events) const {
+    if (events.data.size() != size) {
+        throw std::invalid_argument(
+            fmt::format("Table has {} events, but the list to write back to has {}", size, events.data.size()));
+    }
+    for (size_t row = 0; row < size; row++) {
+        Event& event = events.data[row];
+        ForEachField<Event>([&](auto index, const auto& field) {
+            auto& value = event.*field.member;
+            using M = std::remove_cvref_t<decltype(value)>;
+            if constexpr (std::is_base_of_v<String, M>) {
+                const std::string_view s = strings[columns[index].words[row]];
+                if (value.view() != s) {
+                    value.Assign(s);
+                }
+            } else if constexpr (HasWireLayout<M>) {
+                value.data = std::bit_cast<decltype(value.data)>(columns[index].words[row]);
+            }
+        });
+    }
+}
+
+} // namespace Evo
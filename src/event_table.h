@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <string_view>
+#include <vector>
+
+#include "common/string_pool.h"
+#include "conversion.h"
+#include "tours.h"
+
+namespace Evo {
+
+enum class Compare { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+// Set of rows of an EventTable, one bit per row.
+class RowSet {
+public:
+    RowSet() = default;
+    RowSet(size_t rows, bool all) : words((rows + 63) / 64, all ? ~u64{0} : 0), rows{rows} {
+        if (all && rows % 64 != 0) {
+            words.back() = (u64{1} << (rows % 64)) - 1;
+        }
+    }
+
+    bool Contains(size_t row) const {
+        return (words[row / 64] >> (row % 64)) & 1;
+    }
+    void Insert(size_t row) {
+        words[row / 64] |= u64{1} << (row % 64);
+    }
+    size_t Count() const {
+        size_t count = 0;
+        for (const u64 word : words) {
+            count += std::popcount(word);
+        }
+        return count;
+    }
+    // Calls fn(row) for every row in the set, in order.
+    template <typename F>
+    void ForEach(F&& fn) const {
+        for (size_t w = 0; w < words.size(); w++) {
+            for (u64 word = words[w]; word != 0; word &= word - 1) {
+                fn(w * 64 + std::countr_zero(word));
+            }
+        }
+    }
+
+    RowSet& operator&=(const RowSet& other) {
+        for (size_t w = 0; w < words.size(); w++) {
+            words[w] &= other.words[w];
+        }
+        return *this;
+    }
+    RowSet& operator|=(const RowSet& other) {
+        for (size_t w = 0; w < words.size(); w++) {
+            words[w] |= other.words[w];
+        }
+        return *this;
+    }
+
+    size_t Rows() const {
+        return rows;
+    }
+    std::vector<u64>& Words() {
+        return words;
+    }
+    const std::vector<u64>& Words() const {
+        return words;
+    }
+
+private:
+    std::vector<u64> words;
+    size_t rows = 0;
+};
+
+// Count, sum and range of a numeric column over a set of rows. Min and max are only meaningful when count > 0.
+struct ColumnSummary {
+    size_t count = 0;
+    f64 sum = 0;
+    f64 min = 0;
+    f64 max = 0;
+};
+
+// Column-wise copy of the scalar and string fields of a list of events, for scans and bulk edits that would
+// otherwise pull every cache line of every event. Integer, Boolean and Float fields become contiguous 32-bit
+// columns; strings become 32-bit codes into one shared pool, so comparing them is comparing codes. The fixed-size
+// blocks have no column and stay in the events. Columns are addressed by the index of their field in Fields<Event>.
+// Edits go to the table only, until WriteBack() stores them into the events the table was built from.
+class EventTable {
+public:
+    static constexpr size_t NotFound = FieldCount<Event>;
+
+    explicit EventTable(const Array<Event>& events);
+
+    size_t Size() const {
+        return size;
+    }
+    // Column of the field with that name, or NotFound if there is no such field or it has no column
+    size_t ColumnIndex(std::string_view field) const;
+    std::string_view ColumnName(size_t column) const {
+        return FieldNames<Event>()[column];
+    }
+    WireKind Kind(size_t column) const {
+        return columns[column].kind;
+    }
+
+    s32 GetInt(size_t column, size_t row) const;
+    f32 GetFloat(size_t column, size_t row) const;
+    std::string_view GetString(size_t column, size_t row) const;
+    void SetInt(size_t column, size_t row, s32 value);
+    void SetFloat(size_t column, size_t row, f32 value);
+    void SetString(size_t column, size_t row, std::string_view value);
+
+    RowSet All() const {
+        return RowSet(size, true);
+    }
+    // Removes from rows every row whose value in column does not satisfy `value op operand`. The operand type must
+    // match the column: integers for Integer and Boolean columns, floats for Float columns, strings (Equal and
+    // NotEqual only) for String columns.
+    void Filter(RowSet& rows, size_t column, Compare op, s32 operand) const;
+    void Filter(RowSet& rows, size_t column, Compare op, f32 operand) const;
+    void Filter(RowSet& rows, size_t column, Compare op, std::string_view operand) const;
+
+    ColumnSummary Summarize(size_t column, const RowSet& rows) const;
+
+    // Stores the columns into events, which must be the list the table was built from. Only strings that changed
+    // are copied, so untouched strings keep borrowing from the tour.
+    void WriteBack(Array<Event>& events) const;
+
+private:
+    struct Column {
+        WireKind kind = WireKind::FixedArray;
+        // Integer and Boolean values, Float bit patterns or string codes
+        std::vector<u32> words;
+    };
+
+    const Column& CheckedColumn(size_t column, WireKind kind) const;
+    Column& CheckedColumn(size_t column, WireKind kind) {
+        return const_cast<Column&>(std::as_const(*this).CheckedColumn(column, kind));
+    }
+
+    size_t size;
+    std::array<Column, FieldCount<Event>> columns;
+    Common::StringPool strings;
+};
+
+} // namespace Evo
@@ -1,43 +1,183 @@
+#include "batch.h"
 #include "common/logging.h"
 #include "common/types.h"
+#include "tour_edit.h"
+#include "tour_query.h"
 #include "tours.h"
+#include "validator.h"
 
 #include "filesystem"
+#include "iostream"
+#include "optional"
 #include "string"
 
 void print_usage() {
-    fmt::println("dc-tour-editor <operation> <input> <output>");
+    fmt::println("dc-tour-editor <operation> <input> [output]");
     fmt::println("  -j, --to-json <binary/input/file> <json/output/file>:  Converts a binary formatted dc.tour file to json");
     fmt::println("  -b, --to-binary <json/input/file> <binary/output/file>:  Converts a json formatted dc.tour file to binary");
+    fmt::println("  -B, --batch <input/dir | glob | @manifest> <output/dir>:  Converts many files in parallel, binary ones to "
+                 "json and json ones to binary");
+    fmt::println("  -e, --edit <input/file> <output/file> <statements>...:  Applies edits such as "
+                 "'events[track == \"Norway_*\"].number_of_laps *= 2' and saves in the input's format");
+    fmt::println("  -q, --query <binary/input/file> <query> [--table]:  Prints fields of matching records, e.g. "
+                 "'events[ai_grid_definitions.driver_id == 112].{{event_id, track}}', as JSON lines or a table");
+    fmt::println("  -v, --validate <binary/or/json/input/file>:  Reports duplicate ids and references to records that do "
+                 "not exist");
+}
+
+// Loads a tour and logs every problem found on the way; false if the file could not be loaded.
+static bool LoadTour(Evo::DcTour& tour, const std::string& in, bool binary) {
+    Common::Diagnostics diagnostics;
+    const bool ok = binary ? tour.LoadBinaryFile(in, diagnostics) : tour.LoadJsonFile(in, diagnostics);
+    for (const Common::Diagnostic& d : diagnostics.Entries()) {
+        if (d.severity == Common::Severity::Warning) {
+            LOG_WARNING("{}", d.ToString());
+        } else {
+            LOG_ERROR("{}", d.ToString());
+        }
+    }
+    if (!ok) {
+        LOG_ERROR("Could not load \"{}\": {} errors", in, diagnostics.ErrorCount());
+    }
+    return ok;
+}
+
+// Saves in the binary or JSON format and logs why if that fails; false if nothing was written.
+static bool SaveTour(Evo::DcTour& tour, const std::string& out, bool binary) {
+    try {
+        if (binary) {
+            tour.SaveBinaryFile(out);
+        } else {
+            tour.SaveJsonFile(out);
+        }
+    } catch (const std::runtime_error& e) {
+        LOG_ERROR("{}", e.what());
+        return false;
+    }
+    return true;
+}
+
+static s32 RunValidate(const std::string& in) {
+    Evo::DcTour tour;
+    if (!LoadTour(tour, in, Evo::DcTour::IsBinaryFile(in))) {
+        return 1;
+    }
+    // Lets go of the file, which for JSON is many times the size of the strings, for the rest of the run
+    tour.InternStrings();
+    const std::vector<std::string> problems = Evo::ValidateReferences(tour);
+    for (const std::string& problem : problems) {
+        LOG_ERROR("{}", problem);
+    }
+    if (!problems.empty()) {
+        LOG_ERROR("Found {} problems in \"{}\"", problems.size(), in);
+        return 1;
+    }
+    LOG_INFO("No problems found in \"{}\"", in);
+    return 0;
+}
+
+static s32 RunEdit(const std::string& in, const std::string& out, const std::string& source) {
+    // Compiled before loading, so mistakes in the statements show up at once
+    std::optional<Evo::EditProgram> program;
+    try {
+        program.emplace(source);
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("{}", e.what());
+        return 1;
+    }
+    const bool binary = Evo::DcTour::IsBinaryFile(in);
+    Evo::DcTour tour;
+    if (!LoadTour(tour, in, binary)) {
+        return 1;
+    }
+    // Lets go of the file, which for JSON is many times the size of the strings, before the output is encoded
+    tour.InternStrings();
+    try {
+        LOG_INFO("Made {} assignments with {} statements", program->Apply(tour), program->Size());
+    } catch (const std::out_of_range& e) {
+        LOG_ERROR("{}", e.what());
+        return 1;
+    }
+    return SaveTour(tour, out, binary) ? 0 : 1;
+}
+
+static s32 RunQuery(const std::string& in, const std::string& source, Evo::QueryFormat format) {
+    std::optional<Evo::Query> query;
+    try {
+        query.emplace(source);
+    } catch (const std::invalid_argument& e) {
+        LOG_ERROR("{}", e.what());
+        return 1;
+    }
+    // Only binary files can be read section by section; the output must not be mixed with progress messages
+    if (!Evo::DcTour::IsBinaryFile(in)) {
+        LOG_ERROR("\"{}\" is not a binary dc.tour file; convert it with -b first", in);
+        return 1;
+    }
+    Evo::DcTour tour;
+    Common::Diagnostics diagnostics;
+    if (!tour.LoadBinaryMembers(in, diagnostics, query->Members())) {
+        for (const Common::Diagnostic& d : diagnostics.Entries()) {
+            LOG_ERROR("{}", d.ToString());
+        }
+        return 1;
+    }
+    query->Run(tour, format, std::cout);
+    return 0;
 }
 
 int main(s32 argc, char** argv) {
-    if (argc != 4) {
+    const std::string_view first = argc >= 2 ? argv[1] : "";
+    const bool is_validate = first == "-v" || first == "--validate";
+    const bool is_edit = first == "-e" || first == "--edit";
+    const bool is_query = first == "-q" || first == "--query";
+    const bool valid_count = is_edit    ? argc >= 5
+                             : is_query ? argc == 4 || (argc == 5 && std::string_view(argv[4]) == "--table")
+                                        : argc == (is_validate ? 3 : 4);
+    if (!valid_count) {
         LOG_ERROR("Invalid parameters specified!");
         print_usage();
         return 1;
     }
-    std::string op = argv[1], in = argv[2], out = argv[3];
+    std::string op = argv[1], in = argv[2], out = is_validate ? "" : argv[3];
+
+    if (op == "-B" || op == "--batch") {
+        return Evo::RunBatch(in, out) == 0 ? 0 : 1;
+    }
 
     if (!std::filesystem::is_regular_file(in)) {
         LOG_ERROR("\"{}\" does not exist or is not a file", in);
         return 1;
     }
 
-    if (op == "-j" || op == "--to-json") {
+    if (is_validate) {
+        return RunValidate(in);
+    } else if (is_edit) {
+        // Every further argument is one or more statements
+        std::string source;
+        for (s32 i = 4; i < argc; i++) {
+            source.append(argv[i]).append(";");
+        }
+        return RunEdit(in, out, source);
+    } else if (is_query) {
+        return RunQuery(in, out, argc == 5 ? Evo::QueryFormat::Table : Evo::QueryFormat::JsonLines);
+    } else if (op == "-j" || op == "--to-json") {
         LOG_INFO("Converting {} to json...", in);
         Evo::DcTour tour;
-        tour.LoadBinaryFile(in);
-        tour.SaveJsonFile(out);
+        if (!LoadTour(tour, in, true) || !SaveTour(tour, out, false)) {
+            return 1;
+        }
     } else if (op == "-b" || op == "--to-binary") {
         LOG_INFO("Converting {} to binary...", in);
         Evo::DcTour tour;
-        tour.LoadJsonFile(in);
-        tour.SaveBinaryFile(out);
+        if (!LoadTour(tour, in, false) || !SaveTour(tour, out, true)) {
+            return 1;
+        }
     } else if (op == "-jj") {
         Evo::DcTour tour;
-        tour.LoadJsonFile(in);
-        tour.SaveJsonFile(out);
+        if (!LoadTour(tour, in, false) || !SaveTour(tour, out, false)) {
+            return 1;
+        }
     } else {
         LOG_ERROR("Unknown operation {}", op);
         print_usage();
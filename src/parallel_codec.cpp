@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common/parallel.h"
+#include "parallel_codec.h"
+
+namespace Evo {
+
+// Records per task are cut by size rather than count, so a task is worth handing to another thread whether the
+// section holds 1 KB events or 16 byte collections.
+static constexpr size_t TaskBytes = 256_KB;
+
+// Fragments in flight per worker when encoding; enough to keep every core busy while the finished ones are spliced
+// and flushed, without holding the whole document in memory.
+static constexpr size_t EncodeWindowPerWorker = 4;
+
+namespace {
+struct DecodeTask {
+    void (*decode)(const DecodeTask& task, std::span<const char> data, Common::Diagnostics* diagnostics);
+    void* section;
+    // Records [first, last) of the section, stored at bytes [begin, end) of the file
+    size_t first;
+    size_t last;
+    size_t begin;
+    size_t end;
+};
+
+// Where one element of a JSON data array starts and ends in the text
+struct JsonSpan {
+    size_t begin;
+    size_t end;
+};
+
+struct JsonDecodeTask {
+    void (*decode)(const JsonDecodeTask& task, std::string_view text, std::span<const JsonSpan> spans,
+                   Common::Diagnostics* diagnostics);
+    void* section;
+    // Records [first, last) of the section, whose spans start at spans[span]
+    size_t first;
+    size_t last;
+    size_t span;
+};
+
+struct EncodeTask {
+    void (*encode)(const EncodeTask& task, Common::JsonWriter& w);
+    const void* section;
+    // Records [first, last) of the section
+    size_t first;
+    size_t last;
+};
+} // namespace
+
+template <typename T>
+static void DecodeRecords(const DecodeTask& task, std::span<const char> data, Common::Diagnostics* diagnostics) {
+    std::pmr::vector<T>& records = static_cast<Array<T>*>(task.section)->data;
+    // Offsets stay absolute, so any diagnostics point at the same bytes as the sequential decoder's
+    Common::BinaryReader r(data.first(task.end), diagnostics);
+    r.Seek(task.begin);
+    for (size_t i = task.first; i < task.last; i++) {
+        r >> records[i];
+    }
+}
+
+template <typename T>
+static void ScanSection(Common::BinaryReader& r, Array<T>& section, std::vector<DecodeTask>& tasks) {
+    ReadArrayHeader(r, section);
+    const size_t count = section.data.size();
+    size_t first = 0;
+    size_t begin = r.Offset();
+    for (size_t i = 0; i < count; i++) {
+        SkipBinary<T>(r);
+        if (r.Offset() - begin >= TaskBytes || i + 1 == count) {
+            tasks.push_back({&DecodeRecords<T>, &section, first, i + 1, begin, r.Offset()});
+            first = i + 1;
+            begin = r.Offset();
+        }
+    }
+}
+
+bool DecodeBinaryParallel(Common::BinaryReader& r, DcTour& tour) {
+    const size_t start = r.Offset();
+    std::vector<DecodeTask> tasks;
+    try {
+        ForEachField<DcTour>([&](auto, const auto& field) {
+            auto& member = tour.*field.member;
+            if constexpr (IsArray<std::remove_cvref_t<decltype(member)>>) {
+                ScanSection(r, member, tasks);
+            } else {
+                r >> member;
+            }
+        });
+    } catch (const std::exception&) {
+        r.Seek(start);
+        return false;
+    }
+
+    // Every task reports into its own sink; appending them in task order reproduces the sequential order
+    Common::Diagnostics* diagnostics = r.GetDiagnostics();
+    std::vector<std::optional<Common::Diagnostics>> task_diagnostics(tasks.size());
+    // The scan already covered the bytes, so the decode is the whole file up to where the scan ended
+    const std::span<const char> data = r.Data().first(r.Offset());
+    Common::ParallelFor(tasks.size(), [&](size_t i, size_t) {
+        Common::Diagnostics* sink = nullptr;
+        if (diagnostics) {
+            sink = &task_diagnostics[i].emplace();
+        }
+        tasks[i].decode(tasks[i], data, sink);
+    });
+    if (diagnostics) {
+        for (std::optional<Common::Diagnostics>& d : task_diagnostics) {
+            diagnostics->Append(std::move(*d));
+        }
+    }
+    ValidateRecord(tour, diagnostics, [&] { return fmt::format("offset {:#x}", start); });
+    return true;
+}
+
+template <typename T>
+static void DecodeJsonRecords(const JsonDecodeTask& task, std::string_view text, std::span<const JsonSpan> spans,
+                              Common::Diagnostics* diagnostics) {
+    std::pmr::vector<T>& records = static_cast<Array<T>*>(task.section)->data;
+    Common::JsonReader r(text, diagnostics);
+    for (size_t i = task.first; i < task.last; i++) {
+        const JsonSpan& span = spans[task.span + i - task.first];
+        r.Seek(span.begin);
+        r.ReadRecoverable([&] { r >> records[i]; });
+        // Only possible in a malformed document, where the scan's idea of the layout cannot be trusted
+        if (r.Offset() != span.end) [[unlikely]] {
+            throw std::runtime_error("Record does not end where the scan found it");
+        }
+    }
+}
+
+// Reads the name of a section and scans over its records. Anything the sequential reader would treat specially,
+// like a repeated or missing key, throws so that it gets to handle it.
+template <typename T>
+static void ScanJsonSection(Common::JsonReader& r, Array<T>& section, std::vector<JsonSpan>& spans,
+                            std::vector<JsonDecodeTask>& tasks) {
+    bool has_name = false, has_data = false;
+    r.ReadObject([&](std::string_view key) {
+        if (key == "name" && !has_name) {
+            r >> section.name;
+            has_name = true;
+        } else if (key == "data" && !has_data) {
+            const size_t first_span = spans.size();
+            r.ReadArray([&] {
+                const size_t begin = r.Offset();
+                r.ScanValue();
+                spans.push_back({begin, r.Offset()});
+            });
+            has_data = true;
+
+            const size_t count = spans.size() - first_span;
+            section.data.clear();
+            section.data.resize(count);
+            section.size.data = static_cast<s32>(count);
+            size_t first = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (spans[first_span + i].end - spans[first_span + first].begin >= TaskBytes || i + 1 == count) {
+                    tasks.push_back({&DecodeJsonRecords<T>, &section, first, i + 1, first_span + first});
+                    first = i + 1;
+                }
+            }
+        } else if (key == "name" || key == "data") {
+            throw std::runtime_error(fmt::format("Repeated key '{}'", key));
+        } else {
+            r.SkipValue();
+        }
+    });
+    if (!has_name || !has_data) {
+        throw std::runtime_error("Missing key");
+    }
+}
+
+bool DecodeJsonParallel(Common::JsonReader& r, DcTour& tour) {
+    const size_t start = r.Offset();
+    std::vector<JsonSpan> spans;
+    std::vector<JsonDecodeTask> tasks;
+    try {
+        std::array<bool, FieldCount<DcTour>> seen{};
+        r.ReadObject([&](std::string_view key) {
+            const size_t index = FieldIndex<DcTour>.Find(key);
+            if (index == FieldIndex<DcTour>.NotFound) {
+                throw std::runtime_error(fmt::format("Unknown key '{}'", key));
+            }
+            if (seen[index]) {
+                throw std::runtime_error(fmt::format("Repeated key '{}'", key));
+            }
+            seen[index] = true;
+            ForEachField<DcTour>([&](auto i, const auto& field) {
+                if (i != index) {
+                    return;
+                }
+                auto& member = tour.*field.member;
+                if constexpr (IsArray<std::remove_cvref_t<decltype(member)>>) {
+                    ScanJsonSection(r, member, spans, tasks);
+                } else {
+                    r >> member;
+                }
+            });
+        });
+        if (std::find(seen.begin(), seen.end(), false) != seen.end()) {
+            throw std::runtime_error("Missing key");
+        }
+    } catch (const std::exception&) {
+        r.Seek(start);
+        return false;
+    }
+
+    // Every task reports into its own sink; appending them in task order reproduces the sequential order
+    Common::Diagnostics* diagnostics = r.GetDiagnostics();
+    std::vector<std::optional<Common::Diagnostics>> task_diagnostics(tasks.size());
+    try {
+        Common::ParallelFor(tasks.size(), [&](size_t i, size_t) {
+            Common::Diagnostics* sink = nullptr;
+            if (diagnostics) {
+                sink = &task_diagnostics[i].emplace();
+            }
+            tasks[i].decode(tasks[i], r.Text(), spans, sink);
+        });
+    } catch (...) {
+        // Includes JsonReader::Unrecoverable, after which the sequential reader stops at the same place and reports
+        // only what comes before it
+        r.Seek(start);
+        return false;
+    }
+    if (diagnostics) {
+        for (std::optional<Common::Diagnostics>& d : task_diagnostics) {
+            diagnostics->Append(std::move(*d));
+        }
+    }
+    ValidateRecord(tour, diagnostics, [&] { return start; });
+    return true;
+}
+
+template <typename T>
+static void EncodeRecords(const EncodeTask& task, Common::JsonWriter& w) {
+    const std::pmr::vector<T>& records = static_cast<const Array<T>*>(task.section)->data;
+    for (size_t i = task.first; i < task.last; i++) {
+        w << records[i];
+    }
+}
+
+template <typename T>
+static void PlanSection(const Array<T>& section, std::vector<EncodeTask>& tasks) {
+    // The binary size is a cheap stand-in for the amount of JSON a record turns into
+    size_t first = 0;
+    size_t bytes = 0;
+    for (size_t i = 0; i < section.data.size(); i++) {
+        bytes += BinarySize(section.data[i]);
+        if (bytes >= TaskBytes || i + 1 == section.data.size()) {
+            tasks.push_back({&EncodeRecords<T>, &section, first, i + 1});
+            first = i + 1;
+            bytes = 0;
+        }
+    }
+}
+
+// Runs the tasks a window at a time and splices their output into w in task order. A failing task rethrows once
+// everything before it has been spliced, so the error is the one the sequential writer would have hit first.
+static void EncodeTasks(Common::JsonWriter& w, const std::vector<EncodeTask>& tasks) {
+    const size_t window = std::min(tasks.size(), Common::AvailableWorkers() * EncodeWindowPerWorker);
+    std::vector<std::string> buffers(window);
+    std::vector<std::optional<Common::JsonWriter>> fragments(window);
+    std::vector<std::exception_ptr> errors(window);
+    for (size_t base = 0; base < tasks.size(); base += window) {
+        const size_t count = std::min(window, tasks.size() - base);
+        Common::ParallelFor(count, [&](size_t i, size_t) {
+            try {
+                Common::JsonWriter& fragment = fragments[i].emplace(w.Fragment(base + i > 0, std::move(buffers[i])));
+                tasks[base + i].encode(tasks[base + i], fragment);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+        for (size_t i = 0; i < count; i++) {
+            if (errors[i]) {
+                std::rethrow_exception(errors[i]);
+            }
+            w.Splice(*fragments[i]);
+            buffers[i] = std::move(fragments[i]->Buffer());
+        }
+    }
+}
+
+void EncodeJsonParallel(Common::JsonWriter& w, const DcTour& tour) {
+    // Mirrors the generic record and Array writers, with the array elements handed out to the workers
+    ValidateRecord(tour);
+    w.BeginObject();
+    ForEachField<DcTour>([&](auto, const auto& field) {
+        const auto& member = tour.*field.member;
+        w.Key(field.name);
+        if constexpr (IsArray<std::remove_cvref_t<decltype(member)>>) {
+            std::vector<EncodeTask> tasks;
+            PlanSection(member, tasks);
+            w.BeginObject();
+            w.Key("name") << member.name;
+            w.Key("data").BeginArray();
+            EncodeTasks(w, tasks);
+            w.EndArray();
+            w.EndObject();
+        } else {
+            w << member;
+        }
+    });
+    w.EndObject();
+}
+
+} // namespace Evo
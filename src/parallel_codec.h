@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common/binary_reader.h"
+#include "common/diagnostics.h"
+#include "common/json_reader.h"
+#include "common/json_writer.h"
+#include "tours.h"
+
+namespace Evo {
+
+// Tours smaller than this (in binary bytes) convert faster on one thread than it takes to split up the work and
+// start the pool.
+constexpr size_t ParallelCodecThreshold = 1_MB;
+
+// Decodes the body of a binary tour, r being just past the file header, on all cores. A first pass hops over the
+// records to find where each one starts, then ranges of records are decoded concurrently into the pre-sized
+// arrays. The result, diagnostics included, is the same as `r >> tour`. Returns false with r rewound if the scan
+// finds the data malformed, so the caller can run the sequential decoder to report exactly what is wrong.
+bool DecodeBinaryParallel(Common::BinaryReader& r, DcTour& tour);
+
+// Reads a JSON tour on all cores. A structural scan, which only matches brackets and quotes, finds the extent of
+// every record in the sections' data arrays, then ranges of records are parsed concurrently by readers over the
+// whole text, so error positions and paths are the same as `r >> tour`'s, as are the result and diagnostics.
+// Returns false with r rewound if the document is not laid out as expected or a record cannot be recovered from,
+// so the caller can run the sequential reader to report exactly what is wrong.
+bool DecodeJsonParallel(Common::JsonReader& r, DcTour& tour);
+
+// Writes tour as JSON on all cores, producing exactly the text of `w << tour`. Each section is cut into runs of
+// records that are formatted into separate buffers by the workers, then spliced into w in order.
+void EncodeJsonParallel(Common::JsonWriter& w, const DcTour& tour);
+
+} // namespace Evo
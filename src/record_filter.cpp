@@ -0,0 +1,290 @@
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "common/wildcard.h"
+#include "record_filter.h"
+
+namespace Evo {
+
+const RecordInfo* SectionRecordInfo(size_t section) {
+    const RecordInfo* result = nullptr;
+    ForEachField<DcTour>([&](auto index, const auto& field) {
+        using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+        if constexpr (IsArray<M>) {
+            if (index == section) {
+                result = &RecordInfoOf<typename M::value_type>;
+            }
+        }
+    });
+    return result;
+}
+
+template <typename V>
+static bool CompareValues(V a, Compare op, V b) {
+    switch (op) {
+    case Compare::Equal:
+        return a == b;
+    case Compare::NotEqual:
+        return a != b;
+    case Compare::Less:
+        return a < b;
+    case Compare::LessEqual:
+        return a <= b;
+    case Compare::Greater:
+        return a > b;
+    case Compare::GreaterEqual:
+        return a >= b;
+    }
+    return false;
+}
+
+// Tests one single value, of the kind the condition was checked against, with op in place of the condition's own
+static bool MatchesValue(const Condition& c, Compare op, void* value) {
+    switch (c.kind) {
+    case WireKind::Integer: {
+        const s32 i = static_cast<Integer*>(value)->data;
+        return c.value.kind == WireKind::Integer ? CompareValues<s64>(i, op, c.value.integer)
+                                                 : CompareValues<f64>(i, op, c.value.real);
+    }
+    case WireKind::Float:
+        return CompareValues<f32>(static_cast<Float*>(value)->data, op, static_cast<f32>(c.value.real));
+    case WireKind::Boolean:
+        return CompareValues<bool>(static_cast<Boolean*>(value)->data != 0, op, c.value.integer != 0);
+    default: {
+        const std::string_view s = static_cast<String*>(value)->view();
+        const bool equal = c.glob ? Common::WildcardMatch(c.value.text, s) : s == c.value.text;
+        return equal == (op == Compare::Equal);
+    }
+    }
+}
+
+bool Condition::Matches(const void* record) const {
+    // Fields are only read here; the addresses are shared with the code that edits them
+    void* member = field->address(const_cast<void*>(record));
+    if (field->kind != WireKind::FixedArray) {
+        return MatchesValue(*this, op, member);
+    }
+    // Any element for ==, <, ... and so none at all for !=, which stays the negation of ==
+    const bool negate = op == Compare::NotEqual;
+    for (size_t i = 0; i < field->elements; i++) {
+        void* element = field->element(member, i);
+        if (MatchesValue(*this, negate ? Compare::Equal : op,
+                         element_field ? element_field->address(element) : element)) {
+            return !negate;
+        }
+    }
+    return negate;
+}
+
+static bool IsScalar(WireKind kind) {
+    return kind == WireKind::Integer || kind == WireKind::Float || kind == WireKind::Boolean ||
+           kind == WireKind::String;
+}
+
+size_t ExpressionParser::ParseSection(const RecordInfo*& records) {
+    const size_t start = Position();
+    const std::string_view name = Identifier("section name");
+    const size_t section = FieldIndex<DcTour>.Find(name);
+    records = section != FieldIndex<DcTour>.NotFound ? SectionRecordInfo(section) : nullptr;
+    if (!records) {
+        pos = start;
+        Error(fmt::format("'{}' is not a section of the tour", name));
+    }
+    return section;
+}
+
+Predicate ExpressionParser::ParsePredicate(const RecordInfo& records) {
+    Predicate predicate;
+    if (Consume("[")) {
+        do {
+            auto& group = predicate.groups.emplace_back();
+            do {
+                group.push_back(ParseCondition(records));
+            } while (Consume("&&"));
+        } while (Consume("||"));
+        Expect("]");
+    }
+    return predicate;
+}
+
+Condition ExpressionParser::ParseCondition(const RecordInfo& records) {
+    Condition c;
+    const size_t field_start = Position();
+    const std::string_view name = Identifier("field name");
+    c.field = records.Find(name);
+    if (!c.field) {
+        pos = field_start;
+        Error(fmt::format("No field named '{}'", name));
+    }
+    c.kind = c.field->kind;
+    if (c.kind == WireKind::FixedArray) {
+        c.kind = c.field->element_kind;
+        if (c.field->element_record) {
+            Expect(".");
+            const size_t element_start = Position();
+            const std::string_view element_name = Identifier("field name");
+            c.element_field = c.field->element_record->Find(element_name);
+            if (!c.element_field) {
+                pos = element_start;
+                Error(fmt::format("The elements of '{}' have no field named '{}'", name, element_name));
+            }
+            c.kind = c.element_field->kind;
+        }
+    }
+    if (!IsScalar(c.kind)) {
+        pos = field_start;
+        Error(fmt::format("Field '{}' does not hold a single value", name));
+    }
+
+    const size_t op_start = Position();
+    if (Consume("==")) {
+        c.op = Compare::Equal;
+    } else if (Consume("!=")) {
+        c.op = Compare::NotEqual;
+    } else if (Consume("<=")) {
+        c.op = Compare::LessEqual;
+    } else if (Consume(">=")) {
+        c.op = Compare::GreaterEqual;
+    } else if (Consume("<")) {
+        c.op = Compare::Less;
+    } else if (Consume(">")) {
+        c.op = Compare::Greater;
+    } else {
+        Error("Expected one of ==, !=, <, <=, >, >=");
+    }
+    const size_t value_start = Position();
+    c.value = ParseLiteral();
+    const bool ordered = c.op != Compare::Equal && c.op != Compare::NotEqual;
+    if (c.kind == WireKind::String || c.kind == WireKind::Boolean) {
+        if (c.value.kind != c.kind) {
+            pos = value_start;
+            Error(fmt::format("Expected a {} to compare with", KindName(c.kind)));
+        }
+        if (ordered) {
+            pos = op_start;
+            Error(fmt::format("A {} field can only be compared with == or !=", KindName(c.kind)));
+        }
+        c.glob = c.kind == WireKind::String && c.value.text.find_first_of("*?") != std::string::npos;
+    } else if (c.value.kind != WireKind::Integer && c.value.kind != WireKind::Float) {
+        pos = value_start;
+        Error("Expected a number to compare with");
+    }
+    return c;
+}
+
+const FieldInfo* ExpressionParser::ParseScalarField(const RecordInfo& records) {
+    const size_t start = Position();
+    const std::string_view name = Identifier("field name");
+    const FieldInfo* field = records.Find(name);
+    if (!field) {
+        pos = start;
+        Error(fmt::format("No field named '{}'", name));
+    }
+    if (!IsScalar(field->kind)) {
+        pos = start;
+        Error(fmt::format("Field '{}' does not hold a single value", name));
+    }
+    return field;
+}
+
+Literal ExpressionParser::ParseLiteral() {
+    SkipSpace();
+    Literal literal;
+    if (Consume("\"")) {
+        literal.kind = WireKind::String;
+        while (pos < source.size() && source[pos] != '"') {
+            if (source[pos] == '\\' && pos + 1 < source.size()) {
+                pos++;
+            }
+            literal.text += source[pos++];
+        }
+        Expect("\"");
+        return literal;
+    }
+    if (ConsumeWord("true")) {
+        literal.kind = WireKind::Boolean;
+        literal.integer = 1;
+        return literal;
+    }
+    if (ConsumeWord("false")) {
+        literal.kind = WireKind::Boolean;
+        return literal;
+    }
+    const char* begin = source.data() + pos;
+    const char* end = source.data() + source.size();
+    s64 integer = 0;
+    const auto [int_end, int_error] = std::from_chars(begin, end, integer);
+    const auto [real_end, real_error] = std::from_chars(begin, end, literal.real);
+    if (real_error == std::errc::result_out_of_range) {
+        Error("Number out of range");
+    }
+    if (real_error != std::errc{}) {
+        Error("Expected a value");
+    }
+    // from_chars also reads nan and inf, which no field can usefully be compared with or set to
+    if (!std::isfinite(literal.real)) {
+        Error("Expected a finite number");
+    }
+    // Whole numbers beyond s32 are still fine for Float fields; Integer fields reject them when type checking
+    if (int_error == std::errc{} && int_end == real_end && integer >= std::numeric_limits<s32>::min() &&
+        integer <= std::numeric_limits<s32>::max()) {
+        literal.kind = WireKind::Integer;
+        literal.integer = integer;
+    } else {
+        literal.kind = WireKind::Float;
+    }
+    pos = real_end - source.data();
+    return literal;
+}
+
+std::string_view ExpressionParser::Identifier(std::string_view what) {
+    SkipSpace();
+    const size_t start = pos;
+    while (pos < source.size() && (std::isalnum(static_cast<unsigned char>(source[pos])) || source[pos] == '_')) {
+        pos++;
+    }
+    if (start == pos) {
+        Error(fmt::format("Expected a {}", what));
+    }
+    return source.substr(start, pos - start);
+}
+
+void ExpressionParser::SkipSpace() {
+    while (pos < source.size() && std::isspace(static_cast<unsigned char>(source[pos]))) {
+        pos++;
+    }
+}
+
+bool ExpressionParser::Consume(std::string_view token) {
+    SkipSpace();
+    if (source.substr(pos).starts_with(token)) {
+        pos += token.size();
+        return true;
+    }
+    return false;
+}
+
+bool ExpressionParser::ConsumeWord(std::string_view word) {
+    const size_t end = pos + word.size();
+    if (source.substr(pos).starts_with(word) &&
+        (end == source.size() || !(std::isalnum(static_cast<unsigned char>(source[end])) || source[end] == '_'))) {
+        pos = end;
+        return true;
+    }
+    return false;
+}
+
+void ExpressionParser::Expect(std::string_view token) {
+    if (!Consume(token)) {
+        Error(fmt::format("Expected '{}'", token));
+    }
+}
+
+void ExpressionParser::Error(std::string_view message) const {
+    throw std::invalid_argument(fmt::format("{} at column {} of \"{}\"", message, pos + 1, source));
+}
+
+} // namespace Evo
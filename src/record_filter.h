@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "conversion.h"
+#include "event_table.h"
+#include "tours.h"
+
+namespace Evo {
+
+// Run-time description of one field of a record, generated from its Fields table, for code that picks fields by
+// name at run time, like the edit and query languages.
+struct FieldInfo {
+    std::string_view name;
+    WireKind kind;
+    void* (*address)(void* record);
+    // Writes the field's value, whatever its type
+    void (*write_json)(Common::JsonWriter& w, const void* record);
+    // FixedArray fields only: the number of elements, the address of element i, and what the elements are
+    size_t elements = 0;
+    void* (*element)(void* array, size_t i) = nullptr;
+    WireKind element_kind = WireKind::Record;
+    const struct RecordInfo* element_record = nullptr;
+};
+
+struct RecordInfo {
+    const FieldInfo* fields;
+    size_t count;
+    size_t (*find)(std::string_view name);
+
+    // Field with that name, or nullptr
+    const FieldInfo* Find(std::string_view name) const {
+        const size_t i = find(name);
+        return i < count ? &fields[i] : nullptr;
+    }
+    size_t IndexOf(const FieldInfo* field) const {
+        return field - fields;
+    }
+};
+
+template <typename T>
+constexpr const RecordInfo* RecordInfoFor();
+
+template <typename T, size_t I>
+constexpr FieldInfo MakeFieldInfo() {
+    constexpr auto field = std::get<I>(Fields<T>::value);
+    using M = FieldType<T, I>;
+    FieldInfo info{field.name, field.kind,
+                   [](void* record) -> void* {
+                       return &(static_cast<T*>(record)->*std::get<I>(Fields<T>::value).member);
+                   },
+                   [](Common::JsonWriter& w, const void* record) {
+                       w << static_cast<const T*>(record)->*std::get<I>(Fields<T>::value).member;
+                   }};
+    if constexpr (IsFixedArray<M>) {
+        using E = typename M::value_type;
+        info.elements = M::count;
+        info.element = [](void* array, size_t i) -> void* { return &static_cast<M*>(array)->data[i]; };
+        info.element_kind = WireKindOf<E>();
+        if constexpr (Record<E>) {
+            info.element_record = RecordInfoFor<E>();
+        }
+    }
+    return info;
+}
+
+template <typename T>
+constexpr auto FieldInfos = []<size_t... I>(std::index_sequence<I...>) {
+    return std::array<FieldInfo, sizeof...(I)>{MakeFieldInfo<T, I>()...};
+}(std::make_index_sequence<FieldCount<T>>{});
+
+template <typename T>
+constexpr RecordInfo RecordInfoOf{FieldInfos<T>.data(), FieldCount<T>,
+                                  [](std::string_view name) -> size_t { return FieldIndex<T>.Find(name); }};
+
+template <typename T>
+constexpr const RecordInfo* RecordInfoFor() {
+    return &RecordInfoOf<T>;
+}
+
+// Records of the section with that field index in Fields<DcTour>, or nullptr if the field is not an Array section.
+const RecordInfo* SectionRecordInfo(size_t section);
+
+// A value written in an edit or query.
+struct Literal {
+    // Integer, Float, Boolean or String
+    WireKind kind = WireKind::Integer;
+    s64 integer = 0;
+    // Also set for integers, for arithmetic that mixes them with floats
+    f64 real = 0;
+    std::string text;
+};
+
+// `field op literal`. When field is a fixed array, the condition holds if it holds for any element, except that != holds
+// when no element equals the literal, so that it always selects exactly the records == leaves out. For arrays of
+// records it names a field of the elements, as in `ai_grid_definitions.driver_id == 112`.
+struct Condition {
+    const FieldInfo* field;
+    const FieldInfo* element_field = nullptr;
+    WireKind kind;
+    Compare op;
+    Literal value;
+    bool glob = false;
+
+    bool Matches(const void* record) const;
+};
+
+// Conditions joined by && and then by ||: true when every condition of any one group holds. No groups at all selects
+// every record.
+struct Predicate {
+    std::vector<std::vector<Condition>> groups;
+
+    bool Matches(const void* record) const {
+        if (groups.empty()) {
+            return true;
+        }
+        for (const auto& group : groups) {
+            bool all = true;
+            for (const Condition& c : group) {
+                if (!c.Matches(record)) {
+                    all = false;
+                    break;
+                }
+            }
+            if (all) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Tokenizer and the parts of the grammar shared by the edit and query languages. Errors throw std::invalid_argument
+// with the column of the offending token.
+class ExpressionParser {
+public:
+    explicit ExpressionParser(std::string_view source) : source{source} {}
+
+protected:
+    // `name`, returning the section's index in Fields<DcTour> and its records
+    size_t ParseSection(const RecordInfo*& records);
+    // `[conditions]`, if there is one
+    Predicate ParsePredicate(const RecordInfo& records);
+    Condition ParseCondition(const RecordInfo& records);
+    // A field of the records that holds a single value
+    const FieldInfo* ParseScalarField(const RecordInfo& records);
+    Literal ParseLiteral();
+    std::string_view Identifier(std::string_view what);
+
+    void SkipSpace();
+    size_t Position() {
+        SkipSpace();
+        return pos;
+    }
+    bool AtEnd() {
+        return Position() == source.size();
+    }
+    bool Consume(std::string_view token);
+    bool ConsumeWord(std::string_view word);
+    void Expect(std::string_view token);
+    [[noreturn]] void Error(std::string_view message) const;
+
+    std::string_view source;
+    size_t pos = 0;
+};
+
+} // namespace Evo
@@ -0,0 +1,219 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "common/parallel.h"
+#include "record_filter.h"
+#include "tour_edit.h"
+
+namespace Evo {
+
+enum class AssignOp { Set, Add, Subtract, Multiply, Divide };
+
+struct EditStatement {
+    size_t section;
+    Predicate predicate;
+    const FieldInfo* field;
+    AssignOp op;
+    Literal value;
+};
+
+EditProgram::~EditProgram() = default;
+EditProgram::EditProgram(EditProgram&&) noexcept = default;
+EditProgram& EditProgram::operator=(EditProgram&&) noexcept = default;
+
+// Enough records per task to amortize the hand-off, few enough to balance across cores.
+static constexpr size_t RecordsPerTask = 1024;
+
+class EditParser : public ExpressionParser {
+public:
+    using ExpressionParser::ExpressionParser;
+
+    std::vector<EditStatement> ParseProgram() {
+        std::vector<EditStatement> statements;
+        while (true) {
+            while (Consume(";")) {
+            }
+            if (AtEnd()) {
+                return statements;
+            }
+            statements.push_back(ParseStatement());
+            if (!AtEnd() && !Consume(";")) {
+                Error("Expected ';' between statements");
+            }
+        }
+    }
+
+private:
+    EditStatement ParseStatement() {
+        EditStatement s;
+        const RecordInfo* records;
+        s.section = ParseSection(records);
+        s.predicate = ParsePredicate(*records);
+        Expect(".");
+        s.field = ParseScalarField(*records);
+
+        const size_t op_start = Position();
+        if (Consume("+=")) {
+            s.op = AssignOp::Add;
+        } else if (Consume("-=")) {
+            s.op = AssignOp::Subtract;
+        } else if (Consume("*=")) {
+            s.op = AssignOp::Multiply;
+        } else if (Consume("/=")) {
+            s.op = AssignOp::Divide;
+        } else if (Consume("=")) {
+            s.op = AssignOp::Set;
+        } else {
+            Error("Expected one of =, +=, -=, *=, /=");
+        }
+        const size_t value_start = Position();
+        s.value = ParseLiteral();
+        CheckAssignment(s, op_start, value_start);
+        return s;
+    }
+
+    void CheckAssignment(const EditStatement& s, size_t op_start, size_t value_start) {
+        const Literal& v = s.value;
+        const bool number = v.kind == WireKind::Integer || v.kind == WireKind::Float;
+        if (s.field->kind == WireKind::String || s.field->kind == WireKind::Boolean) {
+            if (s.op != AssignOp::Set) {
+                pos = op_start;
+                Error(fmt::format("A {} field can only be assigned with =", KindName(s.field->kind)));
+            }
+            if (v.kind != s.field->kind) {
+                pos = value_start;
+                Error(fmt::format("Expected a {} to assign", KindName(s.field->kind)));
+            }
+            return;
+        }
+        if (!number) {
+            pos = value_start;
+            Error("Expected a number to assign");
+        }
+        if (s.field->kind == WireKind::Integer && v.kind == WireKind::Float && s.op != AssignOp::Multiply &&
+            s.op != AssignOp::Divide) {
+            pos = value_start;
+            const bool whole = v.real == std::trunc(v.real);
+            Error(whole ? "Integer out of range"
+                        : "Integer fields can only be scaled by fractions; use an integer here");
+        }
+        if (s.op == AssignOp::Divide && v.real == 0) {
+            pos = value_start;
+            Error("Division by zero");
+        }
+    }
+};
+
+EditProgram::EditProgram(std::string_view source) : statements{EditParser(source).ParseProgram()} {}
+
+size_t EditProgram::Size() const {
+    return statements.size();
+}
+
+static void Assign(void* record, size_t row, const EditStatement& s) {
+    void* member = s.field->address(record);
+    const Literal& v = s.value;
+    switch (s.field->kind) {
+    case WireKind::Integer: {
+        s32& value = static_cast<Integer*>(member)->data;
+        f64 result = 0;
+        switch (s.op) {
+        case AssignOp::Set:
+            value = static_cast<s32>(v.integer);
+            return;
+        case AssignOp::Add:
+            result = static_cast<f64>(value + v.integer);
+            break;
+        case AssignOp::Subtract:
+            result = static_cast<f64>(value - v.integer);
+            break;
+        case AssignOp::Multiply:
+            result = std::round(value * v.real);
+            break;
+        case AssignOp::Divide:
+            result = std::round(value / v.real);
+            break;
+        }
+        if (!(result >= std::numeric_limits<s32>::min() && result <= std::numeric_limits<s32>::max())) {
+            throw std::out_of_range(fmt::format("{}[{}].{}: result {} does not fit a 32-bit integer",
+                                                FieldNames<DcTour>()[s.section], row, s.field->name, result));
+        }
+        value = static_cast<s32>(result);
+        return;
+    }
+    case WireKind::Float: {
+        f32& value = static_cast<Float*>(member)->data;
+        f64 result = 0;
+        switch (s.op) {
+        case AssignOp::Set:
+            result = v.real;
+            break;
+        case AssignOp::Add:
+            result = value + v.real;
+            break;
+        case AssignOp::Subtract:
+            result = value - v.real;
+            break;
+        case AssignOp::Multiply:
+            result = value * v.real;
+            break;
+        case AssignOp::Divide:
+            result = value / v.real;
+            break;
+        }
+        // The JSON writer has no way to spell infinity or NaN, and a float overflows well before a double does
+        if (!std::isfinite(static_cast<f32>(result))) {
+            throw std::out_of_range(fmt::format("{}[{}].{}: result {} does not fit a float",
+                                                FieldNames<DcTour>()[s.section], row, s.field->name, result));
+        }
+        value = static_cast<f32>(result);
+        return;
+    }
+    case WireKind::Boolean:
+        static_cast<Boolean*>(member)->data = v.integer != 0;
+        return;
+    default:
+        static_cast<String*>(member)->Assign(v.text);
+        return;
+    }
+}
+
+size_t EditProgram::Apply(DcTour& tour) const {
+    size_t assignments = 0;
+    ForEachField<DcTour>([&](auto index, const auto& field) {
+        using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+        if constexpr (IsArray<M>) {
+            std::vector<const EditStatement*> section_statements;
+            for (const EditStatement& s : statements) {
+                if (s.section == index) {
+                    section_statements.push_back(&s);
+                }
+            }
+            if (section_statements.empty()) {
+                return;
+            }
+            auto& records = (tour.*field.member).data;
+            const size_t tasks = (records.size() + RecordsPerTask - 1) / RecordsPerTask;
+            std::vector<size_t> counts(tasks);
+            Common::ParallelFor(tasks, [&](size_t task, size_t) {
+                const size_t end = std::min(records.size(), (task + 1) * RecordsPerTask);
+                for (size_t row = task * RecordsPerTask; row < end; row++) {
+                    for (const EditStatement* s : section_statements) {
+                        if (s->predicate.Matches(&records[row])) {
+                            Assign(&records[row], row, *s);
+                            counts[task]++;
+                        }
+                    }
+                }
+            });
+            for (const size_t count : counts) {
+                assignments += count;
+            }
+        }
+    });
+    return assignments;
+}
+
+} // namespace Evo
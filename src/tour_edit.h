@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "tours.h"
+
+namespace Evo {
+
+struct EditStatement;
+
+// Compiled list of bulk edits on the sections of a DcTour, written as
+//
+//     events[track == "Norway_*" && difficulty > 3].number_of_laps *= 2; drivers.head_type = 0
+//
+// Each statement names a section, an optional predicate, a field of the section's records and an assignment.
+// Predicates are comparisons of a field with a literal (==, !=, <, <=, >, >=), joined by && and then by ||; string
+// compares take * and ? wildcards, and compares on fixed arrays look at every element (see Condition). Assignments are =, +=, -=, *= and /=; integer fields round scaled values to the
+// nearest integer. Everything is resolved and type checked once, when the program is compiled.
+class EditProgram {
+public:
+    // Statements are separated by ';'. Throws std::invalid_argument at the first error, with its position.
+    explicit EditProgram(std::string_view source);
+    ~EditProgram();
+    EditProgram(EditProgram&&) noexcept;
+    EditProgram& operator=(EditProgram&&) noexcept;
+
+    // Runs every statement over its section in one pass, spread over all cores; for each record the statements apply
+    // in order. Returns the number of assignments made. Throws std::out_of_range if a result does not fit its field,
+    // in which case the tour may be partly edited.
+    size_t Apply(DcTour& tour) const;
+
+    // Number of statements
+    size_t Size() const;
+
+private:
+    std::vector<EditStatement> statements;
+};
+
+} // namespace Evo
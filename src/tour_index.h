@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common/flat_index.h"
+#include "tours.h"
+
+namespace Evo {
+
+inline s32 IndexKey(const Integer& i) {
+    return i.data;
+}
+inline std::string_view IndexKey(const String& s) {
+    return s.view();
+}
+
+// Hash index over one section of a DcTour, keyed by the record member `key`. When several records share a key the
+// first one wins; Insert reports the clash. Edits that touch the key or the shape of the section must go through
+// this class so the index stays in sync. Over a `const Array<T>` Section the index only serves lookups.
+template <typename T, auto key, typename Section = Array<T>>
+class SectionIndex {
+public:
+    using Key = decltype(IndexKey(std::declval<const T&>().*key));
+    // Owning copy of a key, for keys that have to outlive an edit of their record
+    using StoredKey = std::conditional_t<std::is_same_v<Key, std::string_view>, std::string, Key>;
+    static constexpr bool Editable = !std::is_const_v<Section>;
+
+    explicit SectionIndex(Section& section) : section{&section} {
+        Rebuild();
+    }
+
+    void Rebuild() {
+        index.Clear();
+        shadowed.clear();
+        index.Reserve(section->data.size());
+        for (size_t i = 0; i < section->data.size(); i++) {
+            Insert(static_cast<u32>(i));
+        }
+    }
+
+    T* Find(const Key& k)
+        requires Editable
+    {
+        const u32 position = index.Find(k, KeyAt());
+        return position == index.NotFound ? nullptr : &section->data[position];
+    }
+    const T* Find(const Key& k) const {
+        const u32 position = index.Find(k, KeyAt());
+        return position == index.NotFound ? nullptr : &section->data[position];
+    }
+    bool Contains(const Key& k) const {
+        return index.Find(k, KeyAt()) != index.NotFound;
+    }
+
+    // Appends a record to the section. Returns false if its key was already taken; it is still appended.
+    bool Append(T record)
+        requires Editable
+    {
+        section->data.push_back(std::move(record));
+        section->size.data = static_cast<s32>(section->data.size());
+        return Insert(static_cast<u32>(section->data.size() - 1));
+    }
+
+    void Erase(size_t position)
+        requires Editable
+    {
+        const StoredKey old_key{IndexKey(section->data[position].*key)};
+        Unlink(static_cast<u32>(position), old_key);
+        section->data.erase(section->data.begin() + position);
+        section->size.data = static_cast<s32>(section->data.size());
+        index.ShiftDown(static_cast<u32>(position));
+        for (u32& p : shadowed) {
+            if (p > position) {
+                p--;
+            }
+        }
+    }
+
+    // Runs edit(record) on the record at position and re-keys it if the key changed.
+    template <typename F>
+        requires Editable
+    void Modify(size_t position, F&& edit) {
+        T& record = section->data[position];
+        const StoredKey old_key{IndexKey(record.*key)};
+        edit(record);
+        if (IndexKey(record.*key) == old_key) {
+            return;
+        }
+        Unlink(static_cast<u32>(position), old_key);
+        Insert(static_cast<u32>(position));
+    }
+
+    size_t Size() const {
+        return index.Size();
+    }
+
+private:
+    auto KeyAt() const {
+        return [this](u32 position) { return IndexKey(section->data[position].*key); };
+    }
+    bool Insert(u32 position) {
+        const Key k = IndexKey(section->data[position].*key);
+        if (index.Insert(k, position, KeyAt())) {
+            return true;
+        }
+        // A re-keyed record can land on a key that a later record holds; the earlier one still wins
+        const u32 holder = index.Find(k, KeyAt());
+        if (holder > position) {
+            index.Erase(k, holder);
+            index.Insert(k, position, KeyAt());
+            shadowed.push_back(holder);
+        } else {
+            shadowed.push_back(position);
+        }
+        return false;
+    }
+    // Takes the record at position, which was keyed k, out of the index. If it held k, the first duplicate it shadowed
+    // takes its place. Costs a hash lookup plus a pass over the duplicates, which are rare.
+    void Unlink(u32 position, const Key& k) {
+        const auto self = std::ranges::find(shadowed, position);
+        if (self != shadowed.end()) {
+            shadowed.erase(self);
+            return;
+        }
+        index.Erase(k, position);
+        auto heir = shadowed.end();
+        for (auto it = shadowed.begin(); it != shadowed.end(); ++it) {
+            if ((heir == shadowed.end() || *it < *heir) && IndexKey(section->data[*it].*key) == k) {
+                heir = it;
+            }
+        }
+        if (heir != shadowed.end()) {
+            const u32 promoted = *heir;
+            shadowed.erase(heir);
+            Insert(promoted);
+        }
+    }
+
+    Section* section;
+    Common::FlatIndex<Key> index;
+    // Positions of records whose key an earlier record already holds
+    std::vector<u32> shadowed;
+};
+
+// Lookup tables for the records other sections refer to, built in one pass over a loaded DcTour. The tour must
+// outlive the index, and sections must not be resized behind its back. Built over a `const DcTour` (the type is
+// deduced from the constructor argument) it only serves lookups.
+template <typename Tours = DcTour>
+class TourIndex {
+    template <typename T>
+    using Section = std::conditional_t<std::is_const_v<Tours>, const Array<T>, Array<T>>;
+
+public:
+    explicit TourIndex(Tours& tour)
+        : tours{tour.tours}, objectives{tour.objectives}, faceoffs{tour.faceoffs}, unlock_groups{tour.unlock_groups},
+          drivers{tour.drivers}, ghosts{tour.ghosts}, ghost_ids{tour.ghosts}, vehicle_classes{tour.vehicle_classes},
+          events{tour.events}, collections{tour.collections} {}
+
+    void Rebuild() {
+        tours.Rebuild();
+        objectives.Rebuild();
+        faceoffs.Rebuild();
+        unlock_groups.Rebuild();
+        drivers.Rebuild();
+        ghosts.Rebuild();
+        ghost_ids.Rebuild();
+        vehicle_classes.Rebuild();
+        events.Rebuild();
+        collections.Rebuild();
+    }
+
+    SectionIndex<Tour, &Tour::id, Section<Tour>> tours;
+    SectionIndex<Objective, &Objective::id, Section<Objective>> objectives;
+    SectionIndex<FaceOff, &FaceOff::id, Section<FaceOff>> faceoffs;
+    SectionIndex<UnlockGroup, &UnlockGroup::id, Section<UnlockGroup>> unlock_groups;
+    SectionIndex<Driver, &Driver::id, Section<Driver>> drivers;
+    // Face-offs refer to ghosts by name, but ghosts carry an id as well, which must be unique too
+    SectionIndex<Ghost, &Ghost::name, Section<Ghost>> ghosts;
+    SectionIndex<Ghost, &Ghost::id, Section<Ghost>> ghost_ids;
+    SectionIndex<VehicleClass, &VehicleClass::id, Section<VehicleClass>> vehicle_classes;
+    SectionIndex<Event, &Event::event_id, Section<Event>> events;
+    SectionIndex<Collection, &Collection::id, Section<Collection>> collections;
+};
+
+} // namespace Evo
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <string>
+
+#include "common/json_writer.h"
+#include "tour_query.h"
+
+namespace Evo {
+
+namespace {
+class QueryParser : public ExpressionParser {
+public:
+    using ExpressionParser::ExpressionParser;
+
+    void Parse(size_t& section, const RecordInfo*& records, Predicate& predicate,
+               std::vector<const FieldInfo*>& projection) {
+        section = ParseSection(records);
+        predicate = ParsePredicate(*records);
+        if (Consume(".")) {
+            if (Consume("{")) {
+                do {
+                    projection.push_back(ParseField(*records));
+                } while (Consume(","));
+                Expect("}");
+            } else {
+                projection.push_back(ParseField(*records));
+            }
+        } else {
+            for (size_t i = 0; i < records->count; i++) {
+                projection.push_back(&records->fields[i]);
+            }
+        }
+        if (!AtEnd()) {
+            Error("Expected the end of the query");
+        }
+    }
+
+private:
+    const FieldInfo* ParseField(const RecordInfo& records) {
+        const size_t start = Position();
+        const std::string_view name = Identifier("field name");
+        const FieldInfo* field = records.Find(name);
+        if (!field) {
+            pos = start;
+            Error(fmt::format("No field named '{}'", name));
+        }
+        return field;
+    }
+};
+} // namespace
+
+Query::Query(std::string_view source) {
+    QueryParser(source).Parse(section, records, predicate, projection);
+}
+
+// Text of one table cell: strings as they are, everything else as compact JSON
+static std::string CellText(const FieldInfo& field, const void* record, Common::JsonWriter& scratch) {
+    if (field.kind == WireKind::String) {
+        return std::string(static_cast<const String*>(field.address(const_cast<void*>(record)))->view());
+    }
+    scratch.Buffer().clear();
+    field.write_json(scratch, record);
+    return scratch.Buffer();
+}
+
+static void WriteTable(const std::vector<std::vector<std::string>>& rows, std::ostream& out) {
+    std::vector<size_t> widths(rows.front().size());
+    for (const auto& row : rows) {
+        for (size_t i = 0; i < row.size(); i++) {
+            widths[i] = std::max(widths[i], row[i].size());
+        }
+    }
+    std::string line;
+    for (size_t r = 0; r < rows.size(); r++) {
+        line.clear();
+        for (size_t i = 0; i < rows[r].size(); i++) {
+            // The last column is not padded, so lines carry no trailing blanks
+            line += i + 1 < widths.size() ? fmt::format("{:<{}}  ", rows[r][i], widths[i]) : rows[r][i];
+        }
+        out << line << '\n';
+        if (r == 0) {
+            line.clear();
+            for (size_t i = 0; i < widths.size(); i++) {
+                line += std::string(widths[i], '-') + (i + 1 < widths.size() ? "  " : "");
+            }
+            out << line << '\n';
+        }
+    }
+}
+
+size_t Query::Run(const DcTour& tour, QueryFormat format, std::ostream& out) const {
+    size_t matches = 0;
+    Common::JsonWriter lines(&out);
+    lines.SetCompact(true);
+    Common::JsonWriter scratch;
+    scratch.SetCompact(true);
+    std::vector<std::vector<std::string>> table;
+    if (format == QueryFormat::Table) {
+        auto& header = table.emplace_back();
+        for (const FieldInfo* field : projection) {
+            header.emplace_back(field->name);
+        }
+    }
+
+    ForEachField<DcTour>([&](auto index, const auto& field) {
+        using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+        if constexpr (IsArray<M>) {
+            if (index != section) {
+                return;
+            }
+            for (const auto& record : (tour.*field.member).data) {
+                if (!predicate.Matches(&record)) {
+                    continue;
+                }
+                matches++;
+                if (format == QueryFormat::Table) {
+                    auto& row = table.emplace_back();
+                    for (const FieldInfo* f : projection) {
+                        row.push_back(CellText(*f, &record, scratch));
+                    }
+                } else {
+                    lines.BeginObject();
+                    for (const FieldInfo* f : projection) {
+                        lines.Key(f->name);
+                        f->write_json(lines, &record);
+                    }
+                    lines.EndObject();
+                    lines.Buffer() += '\n';
+                }
+            }
+        }
+    });
+
+    if (format == QueryFormat::Table) {
+        WriteTable(table, out);
+    }
+    lines.Flush();
+    return matches;
+}
+
+} // namespace Evo
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "record_filter.h"
+#include "tours.h"
+
+namespace Evo {
+
+enum class QueryFormat { JsonLines, Table };
+
+// Compiled query over one section of a DcTour, written as
+//
+//     events[ai_grid_definitions.driver_id == 112].{event_id, track}
+//
+// The predicate is the one of the edit language (see EditProgram) and may be left out. The projection after the
+// dot is one field or a list of them in braces; without it every field is printed.
+class Query {
+public:
+    // Throws std::invalid_argument at the first error, with its position.
+    explicit Query(std::string_view source);
+
+    // The members of the tour the query reads, for DcTour::LoadBinaryMembers
+    u64 Members() const {
+        return u64{1} << section;
+    }
+
+    // Writes the projected fields of every matching record to out, as one JSON object per line or as a table with a
+    // header row. Returns the number of matches.
+    size_t Run(const DcTour& tour, QueryFormat format, std::ostream& out) const;
+
+private:
+    size_t section;
+    const RecordInfo* records;
+    Predicate predicate;
+    std::vector<const FieldInfo*> projection;
+};
+
+} // namespace Evo
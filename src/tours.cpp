@@ -1,181 +1,402 @@
 #include "common/assert.h"
 #include "common/logging.h"
+#include "common/parallel.h"
+#include "common/string_pool.h"
 #include "json.hpp"
+#include "parallel_codec.h"
 #include "tours.h"
 
 #include <filesystem>
 #include <fstream>
 #include <istream>
 #include <ostream>
-#include <sstream>
+#include <stdexcept>
 
 namespace Evo {
 
 using nlohmann::json;
 
-template <typename T>
-T read_le(std::istream& is) {
-    uint8_t bytes[sizeof(T)];
-    is.read(reinterpret_cast<char*>(bytes), sizeof(T));
-    T value = 0;
-    for (size_t i = 0; i < sizeof(T); ++i) {
-        value |= static_cast<T>(bytes[i]) << (i * 8);
+// One read for the whole file; the decoders then work on memory instead of going through the stream per field.
+static std::pmr::vector<char> ReadWholeFile(const std::string& path, std::pmr::memory_resource* resource) {
+    std::ifstream is(path, std::ios::binary | std::ios::ate);
+    if (!is.is_open()) {
+        throw std::runtime_error(fmt::format("Could not open \"{}\"", path));
     }
-    return value;
+    std::pmr::vector<char> buffer(static_cast<size_t>(is.tellg()), resource);
+    is.seekg(0);
+    is.read(buffer.data(), buffer.size());
+    if (is.gcount() != static_cast<std::streamsize>(buffer.size())) {
+        throw std::runtime_error(fmt::format("Could not read \"{}\"", path));
+    }
+    return buffer;
+}
+
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Integer& i) {
+    i.data = r.Read<s32>();
+    return r;
 }
 
-template <typename T>
-std::ostream& write_le(std::ostream& os, T value) {
-    static_assert(std::is_integral_v<T>);
-    for (size_t i = 0; i < sizeof(T); ++i) {
-        uint8_t byte = static_cast<uint8_t>((value >> (i * 8)) & 0xFF);
-        os.put(static_cast<char>(byte));
+Common::BinaryReader& operator>>(Common::BinaryReader& r, String& s) {
+    s32 len = r.Read<s32>();
+    if (len < 0) [[unlikely]] {
+        throw std::out_of_range(fmt::format("Invalid string length {} at offset {:#x}", len, r.Offset() - 4));
     }
-    return os;
+    s.Borrow(r.ReadBytes(len));
+    return r;
 }
 
-std::istream& operator>>(std::istream& is, Integer& i) {
-    i.data = read_le<u32>(is);
-    return is;
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Boolean& b) {
+    b.data = r.Read<s32>();
+    return r;
 }
 
-std::istream& operator>>(std::istream& is, String& s) {
-    is >> s.len;
-    s.data.resize(s.len + 1);
-    is.read(s.data.data(), s.len);
-    s.data[s.len] = '\0';
-    return is;
+Common::BinaryReader& operator>>(Common::BinaryReader& r, Float& f) {
+    static_assert(sizeof(f32) == sizeof(u32));
+    u32 bits = r.Read<u32>();
+    std::memcpy(&f.data, &bits, sizeof(f.data));
+    return r;
 }
 
-std::istream& operator>>(std::istream& is, Boolean& b) {
-    b.data = read_le<u32>(is);
-    return is;
+Common::JsonReader& operator>>(Common::JsonReader& r, Integer& i) {
+    i.data = static_cast<s32>(r.ReadInteger());
+    return r;
 }
 
-std::istream& operator>>(std::istream& is, Float& f) {
-    uint8_t bytes[4];
-    is.read(reinterpret_cast<char*>(bytes), 4);
-    uint32_t bits = static_cast<u32>(bytes[0]) | (static_cast<u32>(bytes[1]) << 8) |
-                    (static_cast<u32>(bytes[2]) << 16) | (static_cast<u32>(bytes[3]) << 24);
-    std::memcpy(&f.data, &bits, sizeof(f.data));
-    return is;
+Common::JsonReader& operator>>(Common::JsonReader& r, String& s) {
+    std::string_view str = r.ReadString();
+    if (r.InSource(str)) {
+        s.Borrow(str);
+    } else {
+        s.Assign(str);
+    }
+    return r;
+}
+
+Common::JsonReader& operator>>(Common::JsonReader& r, HexString& s) {
+    s.AssignHex(r.ReadString());
+    return r;
+}
+
+Common::JsonReader& operator>>(Common::JsonReader& r, Boolean& b) {
+    b.data = r.ReadBool() ? 1 : 0;
+    return r;
+}
+
+Common::JsonReader& operator>>(Common::JsonReader& r, Float& f) {
+    f.data = static_cast<f32>(r.ReadFloat());
+    return r;
+}
+
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Integer& i) {
+    w.WriteInteger(i.data);
+    return w;
+}
+
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const String& s) {
+    w.WriteString(s.view());
+    return w;
+}
+
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const HexString& s) {
+    w.WriteHex(s.view());
+    return w;
+}
+
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Boolean& b) {
+    w.WriteBool(b.data != 0);
+    return w;
+}
+
+Common::JsonWriter& operator<<(Common::JsonWriter& w, const Float& f) {
+    w.WriteFloat(f.data);
+    return w;
 }
 
-std::ostream& operator<<(std::ostream& os, Integer& i) {
-    write_le<s32>(os, i);
-    return os;
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Integer& i) {
+    w.Write<s32>(i.data);
+    return w;
 }
 
-std::ostream& operator<<(std::ostream& os, String& s) {
-    os << s.len;
-    os.write(s.data.data(), s.len);
-    return os;
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const String& s) {
+    w.Write<s32>(s.size());
+    w.WriteBytes(s.view());
+    return w;
 }
 
-std::ostream& operator<<(std::ostream& os, Boolean& b) {
-    write_le<u32>(os, b);
-    return os;
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Boolean& b) {
+    w.Write<s32>(b.data);
+    return w;
 }
 
-std::ostream& operator<<(std::ostream& os, Float& f) {
+Common::BinaryWriter& operator<<(Common::BinaryWriter& w, const Float& f) {
     static_assert(sizeof(f32) == sizeof(u32));
     u32 bits;
     std::memcpy(&bits, &f.data, sizeof(bits));
-    write_le<u32>(os, bits);
-    return os;
+    w.Write<u32>(bits);
+    return w;
 }
 
-void Event::Validate() const {
-    int player_def_count = 0;
-    for (int i = 0; i < 12; i++) {
-        if (ai_grid_definitions[i].car_id == -1 && ai_grid_definitions[i].driver_id == -1 &&
-            ai_grid_definitions[i].unk3 == -1.0 && ai_grid_definitions[i].unk4 == -1.0) {
-            player_def_count++;
+size_t BinarySize(const Integer&) {
+    return sizeof(s32);
+}
+
+size_t BinarySize(const String& s) {
+    return sizeof(s32) + s.size();
+}
+
+size_t BinarySize(const Boolean&) {
+    return sizeof(s32);
+}
+
+size_t BinarySize(const Float&) {
+    return sizeof(f32);
+}
+
+s32 Event::PlayerSlotCount() const {
+    s32 count = 0;
+    for (const AiGridDefinition& slot : ai_grid_definitions.data) {
+        if (slot.car_id == -1 && slot.driver_id == -1 && slot.unk3 == -1.0 && slot.unk4 == -1.0) {
+            count++;
         }
     }
+    return count;
+}
+
+void Event::Validate() const {
+    const s32 player_def_count = PlayerSlotCount();
     if (player_def_count != 1) {
-        LOG_CRITICAL("Incorrect amount of players specified in event {}: {}, please specify exactly one!",
-                     event_id.data, player_def_count);
+        throw Common::ValidationError(
+            Common::Severity::Warning,
+            fmt::format("Incorrect amount of players specified in event {}: {}, please specify exactly one!",
+                        event_id.data, player_def_count));
     }
 }
 
+DcTour::DcTour(std::pmr::memory_resource* resource)
+    : tours{resource}, objectives{resource}, faceoffs{resource}, unlock_groups{resource}, drivers{resource},
+      ghosts{resource}, vehicle_classes{resource}, events{resource}, collections{resource} {}
+
 void DcTour::Validate() const {
-    ASSERT_MSG(version == 44, "Unsupported version {}", version.data);
-}
-
-#define DBAJO(Type, ...) DECLARE_BINARY_AND_JSON_OPERATIONS(Type, __VA_ARGS__)
-DBAJO(DcTour, tourdata_str, version, tours, objectives, faceoffs, unlock_groups, drivers, ghosts, vehicle_classes,
-      events, collections)
-DBAJO(Collection, id, name, unk2, unk3)
-DBAJO(Event, position_in_championship, race_id, event_id, unk4, trophy_id, tour_menu_lams_id, gameplay_menu_lams_id,
-      unlock_group, group_position, type_texture, texture_small, texture_small_position, texture_large,
-      entry_requirements, fame_per_star_earned, trophy_completed, track, time_of_day, speed_of_time, weather,
-      precipitation, precipitation_time_scalar, unk5, difficulty, number_of_laps, type, objectives,
-      extra_star_requirements, grid_modifier, ai_grid_definitions, fame_earned_on_positions)
-DBAJO(VehicleClass, id, name, vehicle_ids)
-DBAJO(Ghost, id, name, unk3, livery)
-DBAJO(Driver, id, unk2, name, country, pronoun, race, head_type, body_type, difficulty, team, color_rgba, unk8, livery)
-DBAJO(UnlockGroup, id, tour_id, menu_layout, stars_to_unlock, is_championship, championship_texture, lams_id, unk8)
-DBAJO(FaceOff, id, ghost, opponent_name)
-DBAJO(Objective, id, objective_str, operator_type, lams_id, unk3)
-DBAJO(Tour, id, lams_id, unk3, license_mask, menu_texture, texture_tile_set, is_tour_active, unk8, dlc_requirement,
-      completed_texture, license_type, included_in_collection)
-DBAJO(AiGridDefinition, driver_id, car_id, unk3, unk4)
-DBAJO(EventObjective, gold_objective_type, gold_objective_target_int, gold_objective_target_str, silver_objective_type,
-      silver_objective_target_int, silver_objective_target_str)
+    if (version != 44) {
+        throw Common::ValidationError(Common::Severity::Error, fmt::format("Unsupported version {}", version.data));
+    }
+}
+
+void DcTour::InternStrings() {
+    auto pool = std::make_shared<Common::StringPool>(events.data.get_allocator().resource());
+    ForEachString(*this, [&](String& s) { s.Borrow(pool->Intern(s.view())); });
+    backing = std::move(pool);
+}
+
+bool DcTour::IsBinaryFile(const std::string& path) {
+    char signature[4] = {};
+    std::ifstream is(path, std::ios::binary);
+    is.read(signature, sizeof(signature));
+    return is.gcount() == sizeof(signature) && std::string_view(signature, sizeof(signature)) == "EVOS";
+}
+
+// The overloads without a diagnostics sink keep the old contract: the file loads or the program stops.
+static void LogDiagnostics(const Common::Diagnostics& diagnostics) {
+    for (const Common::Diagnostic& d : diagnostics.Entries()) {
+        if (d.severity == Common::Severity::Warning) {
+            LOG_WARNING("{}", d.ToString());
+        } else {
+            LOG_ERROR("{}", d.ToString());
+        }
+    }
+}
 
 void DcTour::LoadBinaryFile(const std::string& path) {
+    Common::Diagnostics diagnostics;
+    const bool ok = LoadBinaryFile(path, diagnostics);
+    LogDiagnostics(diagnostics);
+    if (!ok) {
+        UNREACHABLE_MSG("Error while reading \"{}\"", path);
+    }
+}
+
+void DcTour::LoadJsonFile(const std::string& path) {
+    Common::Diagnostics diagnostics;
+    const bool ok = LoadJsonFile(path, diagnostics);
+    LogDiagnostics(diagnostics);
+    if (!ok) {
+        UNREACHABLE_MSG("Error while reading \"{}\"", path);
+    }
+}
+
+static bool ReadSignature(Common::BinaryReader& r, Common::Diagnostics& diagnostics) {
+    std::string_view signature = r.ReadBytes(4);
+    std::string_view endianness = r.ReadBytes(4);
+    if (signature != "EVOS" || endianness != "LITL") {
+        diagnostics.Report(Common::Severity::Error, "offset 0x0",
+                           fmt::format("Signature is {}, endianness is {}", signature, endianness));
+        return false;
+    }
+    return true;
+}
+
+bool DcTour::LoadBinaryFile(const std::string& path, Common::Diagnostics& diagnostics) {
     LOG_INFO("Loading \"{}\"", path);
-    std::ifstream is(path, std::ios::binary);
-    char signature[5], endianness[5];
-    DcTour tour = DcTour();
-    is >> signature >> endianness;
-    ASSERT_MSG(std::string(signature) == "EVOS", "Signature is {}", signature);
-    ASSERT_MSG(std::string(endianness) == "LITL", "Endianness is {}", endianness);
+    std::shared_ptr<const std::pmr::vector<char>> buffer;
     try {
-        is >> *this;
-    } catch (std::exception e) {
-        UNREACHABLE_MSG("Error while reading: {}", e.what());
+        // The file goes wherever the sections are allocated
+        buffer = std::make_shared<const std::pmr::vector<char>>(
+            ReadWholeFile(path, events.data.get_allocator().resource()));
+    } catch (const std::exception& e) {
+        diagnostics.Report(Common::Severity::Error, path, e.what());
+        return false;
     }
-    return;
+    Common::BinaryReader r(*buffer, &diagnostics);
+    try {
+        if (!ReadSignature(r, diagnostics)) {
+            return false;
+        }
+        if (Common::AvailableWorkers() == 1 || buffer->size() < ParallelCodecThreshold ||
+            !DecodeBinaryParallel(r, *this)) {
+            r >> *this;
+        }
+    } catch (const std::exception& e) {
+        // Past a broken length or a truncation there is no telling where the next record starts, so stop here
+        diagnostics.Report(Common::Severity::Error, fmt::format("offset {:#x}", r.Offset()), e.what());
+        return false;
+    }
+    backing = std::move(buffer);
+    if (r.Remaining() != 0) {
+        diagnostics.Report(Common::Severity::Warning, fmt::format("offset {:#x}", r.Offset()),
+                           fmt::format("Ignoring {} trailing bytes", r.Remaining()));
+    }
+    return !diagnostics.HasErrors();
 }
 
-void DcTour::LoadJsonFile(const std::string& path) {
+bool DcTour::LoadBinaryMembers(const std::string& path, Common::Diagnostics& diagnostics, u64 members) {
+    static_assert(FieldCount<DcTour> <= 64, "One bit per member");
+    std::shared_ptr<const std::pmr::vector<char>> buffer;
+    try {
+        buffer = std::make_shared<const std::pmr::vector<char>>(
+            ReadWholeFile(path, events.data.get_allocator().resource()));
+    } catch (const std::exception& e) {
+        diagnostics.Report(Common::Severity::Error, path, e.what());
+        return false;
+    }
+    Common::BinaryReader r(*buffer, &diagnostics);
+    try {
+        if (!ReadSignature(r, diagnostics)) {
+            return false;
+        }
+        ForEachField<DcTour>([&](auto index, const auto& field) {
+            using M = typename std::remove_cvref_t<decltype(field)>::member_type;
+            // Nothing past the last wanted member is even looked at
+            if ((members >> index) == 0) {
+                return;
+            }
+            if ((members >> index) & 1) {
+                r >> this->*field.member;
+            } else {
+                SkipBinary<M>(r);
+            }
+        });
+    } catch (const std::exception& e) {
+        diagnostics.Report(Common::Severity::Error, fmt::format("offset {:#x}", r.Offset()), e.what());
+        return false;
+    }
+    backing = std::move(buffer);
+    return !diagnostics.HasErrors();
+}
+
+bool DcTour::LoadJsonFile(const std::string& path, Common::Diagnostics& diagnostics) {
     LOG_INFO("Loading \"{}\"", path);
-    std::ifstream is(path, std::ios::binary);
-    ordered_json j;
-    is >> j;
+    std::shared_ptr<const std::pmr::vector<char>> buffer;
     try {
-        *this = j.get<DcTour>();
-    } catch (nlohmann::json_abi_v3_12_0::detail::exception& e) {
-        UNREACHABLE_MSG("Error while reading: {}", e.what());
+        // The file goes wherever the sections are allocated
+        buffer = std::make_shared<const std::pmr::vector<char>>(
+            ReadWholeFile(path, events.data.get_allocator().resource()));
+    } catch (const std::exception& e) {
+        diagnostics.Report(Common::Severity::Error, path, e.what());
+        return false;
     }
-    return;
+    Common::JsonReader r(std::string_view(buffer->data(), buffer->size()), &diagnostics);
+    bool decoded = false;
+    try {
+        if (Common::AvailableWorkers() == 1 || buffer->size() < ParallelCodecThreshold ||
+            !DecodeJsonParallel(r, *this)) {
+            r >> *this;
+        }
+        r.Finish();
+        decoded = true;
+    } catch (const Common::JsonReader::Unrecoverable&) {
+    } catch (const Common::JsonReader::SyntaxError& e) {
+        diagnostics.Report(Common::Severity::Error, r.Offset(), e.what(), e.offset);
+    } catch (const std::exception& e) {
+        diagnostics.Report(Common::Severity::Error, r.Offset(), e.what());
+    }
+    r.ResolveLocations();
+    if (!decoded) {
+        return false;
+    }
+    backing = std::move(buffer);
+    return !diagnostics.HasErrors();
+}
+
+// Removes what a failed save left behind, so no truncated tour is mistaken for a good one.
+static void RemovePartialFile(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
 }
 
 void DcTour::SaveBinaryFile(const std::string& path) {
+    std::vector<char> buffer;
+    SaveBinaryFile(path, buffer);
+}
+
+void DcTour::SaveBinaryFile(const std::string& path, std::vector<char>& buffer) {
     LOG_INFO("Saving \"{}\"", path);
-    std::ofstream ofs(path, std::ios::binary);
-    std::ostringstream os(std::ios::binary);
+    constexpr std::string_view header = "EVOSLITL";
+    // The exact size is known up front, so everything is encoded into one buffer and written with a single call
+    buffer.resize(header.size() + BinarySize(*this));
+    Common::BinaryWriter w(buffer);
     try {
-        os << "EVOSLITL" << *this;
-    } catch (std::exception e) {
-        UNREACHABLE_MSG("Error while writing: {}", e.what());
+        w.WriteBytes(header);
+        w << *this;
+    } catch (const std::exception& e) {
+        throw std::runtime_error(fmt::format("Error while writing \"{}\": {}", path, e.what()));
+    }
+    ASSERT_MSG(w.Offset() == buffer.size(), "Wrote {} bytes, expected {}", w.Offset(), buffer.size());
+    std::ofstream ofs(path, std::ios::binary);
+    ofs.write(buffer.data(), buffer.size());
+    ofs.close();
+    if (!ofs) {
+        RemovePartialFile(path);
+        throw std::runtime_error(fmt::format("Could not write \"{}\"", path));
     }
-    ofs << os.str();
 }
 
 void DcTour::SaveJsonFile(const std::string& path) {
+    std::string buffer;
+    SaveJsonFile(path, buffer);
+}
+
+void DcTour::SaveJsonFile(const std::string& path, std::string& buffer) {
     LOG_INFO("Saving \"{}\"", path);
-    nlohmann::ordered_json j = *this;
     std::ofstream ofs(path, std::ios::binary);
-    std::ostringstream os(std::ios::binary);
+    Common::JsonWriter w(&ofs, std::move(buffer));
     try {
-        os << std::setw(2) << j << std::endl;
-    } catch (nlohmann::json_abi_v3_12_0::detail::exception& e) {
-        UNREACHABLE_MSG("Error while writing: {}", e.what());
+        if (Common::AvailableWorkers() > 1 && BinarySize(*this) >= ParallelCodecThreshold) {
+            EncodeJsonParallel(w, *this);
+        } else {
+            w << *this;
+        }
+        w.Finish();
+        ofs.close();
+        if (!ofs) {
+            throw std::runtime_error("Could not write the file");
+        }
+    } catch (const std::exception& e) {
+        // The JSON is streamed out as it is encoded, so part of it may already be on disk
+        ofs.close();
+        RemovePartialFile(path);
+        throw std::runtime_error(fmt::format("Error while writing \"{}\": {}", path, e.what()));
     }
-    ofs << os.str();
+    buffer = std::move(w.Buffer());
 }
 
 } // namespace Evo
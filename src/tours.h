@@ -1,12 +1,16 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstring>
 #include <istream>
+#include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "common/assert.h"
+#include "common/diagnostics.h"
 #include "common/types.h"
 
 #include "common_data_types.h"
@@ -164,6 +168,8 @@ public:
     FixedArray<AiGridDefinition, 12> ai_grid_definitions;
     FixedArray<Integer, 12> fame_earned_on_positions;
 
+    // Grid slots with every field set to -1 belong to the player
+    s32 PlayerSlotCount() const;
     void Validate() const;
 };
 
@@ -177,6 +183,11 @@ public:
 
 class DcTour : public DataType {
 public:
+    DcTour() = default;
+    // Allocates the sections and the contents of a loaded file from resource, e.g. a Common::Arena, which must outlive
+    // the tour and everything that borrows from it.
+    explicit DcTour(std::pmr::memory_resource* resource);
+
     String tourdata_str;
     Integer version;
     Array<Tour> tours;
@@ -189,13 +200,147 @@ public:
     Array<Event> events;
     Array<Collection> collections;
 
+    // What the Strings above borrow from: the loaded file while decoding, then the pool they are interned into
+    std::shared_ptr<const void> backing;
+
     void Validate() const;
 
+    // Moves every string into one pool, where repeated values (tracks, weather, textures, LAMS ids) share a single
+    // copy, and lets go of the loaded file. The loaders leave this out, as conversions drop the tour right after
+    // saving; call it on tours that are kept around, and again after bulk edits to re-share the strings.
+    void InternStrings();
+
+    // True if the file starts with the binary signature, as opposed to being JSON
+    static bool IsBinaryFile(const std::string& path);
+
     void LoadBinaryFile(const std::string& path);
     void LoadJsonFile(const std::string& path);
+    // Report every problem to diagnostics instead of stopping the program, and return false if any was an error.
+    // The tour is then only partially filled in and must not be saved.
+    bool LoadBinaryFile(const std::string& path, Common::Diagnostics& diagnostics);
+    bool LoadJsonFile(const std::string& path, Common::Diagnostics& diagnostics);
+    // Decodes only the members of a binary file whose bit is set in `members` (bit i for field i of Fields<DcTour>),
+    // hopping over the ones in between and stopping after the last; the others stay empty. Does not log.
+    bool LoadBinaryMembers(const std::string& path, Common::Diagnostics& diagnostics, u64 members);
 
+    // Throw std::runtime_error if the tour cannot be encoded (a string that is not valid UTF-8, say) or the file
+    // cannot be written; no partial file is left behind.
     void SaveBinaryFile(const std::string& path);
     void SaveJsonFile(const std::string& path);
+    // Same as above, but encode through the given buffer so repeated conversions can reuse its memory
+    void SaveBinaryFile(const std::string& path, std::vector<char>& buffer);
+    void SaveJsonFile(const std::string& path, std::string& buffer);
+};
+
+// Serialization tables: the order of the fields is the order in the binary file and in the JSON objects
+
+template <>
+struct Fields<EventObjective> {
+    using T = EventObjective;
+    static constexpr auto value = std::tuple{EVO_FIELD(gold_objective_type), EVO_FIELD(gold_objective_target_int),
+                                             EVO_FIELD(gold_objective_target_str), EVO_FIELD(silver_objective_type),
+                                             EVO_FIELD(silver_objective_target_int),
+                                             EVO_FIELD(silver_objective_target_str)};
+};
+
+template <>
+struct Fields<AiGridDefinition> {
+    using T = AiGridDefinition;
+    static constexpr auto value = std::tuple{EVO_FIELD(driver_id), EVO_FIELD(car_id), EVO_FIELD(unk3), EVO_FIELD(unk4)};
+};
+
+// An AI grid slot is stored exactly as it appears on disk, so the 12-slot grids are copied as one block
+static_assert(std::is_trivially_copyable_v<AiGridDefinition> && std::is_standard_layout_v<AiGridDefinition>);
+static_assert(sizeof(AiGridDefinition) == 16 && offsetof(AiGridDefinition, driver_id) == 0 &&
+              offsetof(AiGridDefinition, car_id) == 4 && offsetof(AiGridDefinition, unk3) == 8 &&
+              offsetof(AiGridDefinition, unk4) == 12);
+template <>
+constexpr bool HasWireLayout<AiGridDefinition> = true;
+
+template <>
+struct Fields<Tour> {
+    using T = Tour;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(lams_id), EVO_FIELD(unk3),
+                                             EVO_FIELD(license_mask), EVO_FIELD(menu_texture),
+                                             EVO_FIELD(texture_tile_set), EVO_FIELD(is_tour_active), EVO_FIELD(unk8),
+                                             EVO_FIELD(dlc_requirement), EVO_FIELD(completed_texture),
+                                             EVO_FIELD(license_type), EVO_FIELD(included_in_collection)};
+};
+
+template <>
+struct Fields<Objective> {
+    using T = Objective;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(objective_str), EVO_FIELD(operator_type),
+                                             EVO_FIELD(lams_id), EVO_FIELD(unk3)};
+};
+
+template <>
+struct Fields<FaceOff> {
+    using T = FaceOff;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(ghost), EVO_FIELD(opponent_name)};
+};
+
+template <>
+struct Fields<UnlockGroup> {
+    using T = UnlockGroup;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(tour_id), EVO_FIELD(menu_layout),
+                                             EVO_FIELD(stars_to_unlock), EVO_FIELD(is_championship),
+                                             EVO_FIELD(championship_texture), EVO_FIELD(lams_id), EVO_FIELD(unk8)};
+};
+
+template <>
+struct Fields<Driver> {
+    using T = Driver;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(unk2), EVO_FIELD(name), EVO_FIELD(country),
+                                             EVO_FIELD(pronoun), EVO_FIELD(race), EVO_FIELD(head_type),
+                                             EVO_FIELD(body_type), EVO_FIELD(difficulty), EVO_FIELD(team),
+                                             EVO_FIELD(color_rgba), EVO_FIELD(unk8), EVO_FIELD(livery)};
+};
+
+template <>
+struct Fields<Ghost> {
+    using T = Ghost;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(name), EVO_FIELD(unk3), EVO_FIELD(livery)};
+};
+
+template <>
+struct Fields<VehicleClass> {
+    using T = VehicleClass;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(name), EVO_FIELD(vehicle_ids)};
+};
+
+template <>
+struct Fields<Event> {
+    using T = Event;
+    static constexpr auto value = std::tuple{EVO_FIELD(position_in_championship), EVO_FIELD(race_id),
+                                             EVO_FIELD(event_id), EVO_FIELD(unk4), EVO_FIELD(trophy_id),
+                                             EVO_FIELD(tour_menu_lams_id), EVO_FIELD(gameplay_menu_lams_id),
+                                             EVO_FIELD(unlock_group), EVO_FIELD(group_position),
+                                             EVO_FIELD(type_texture), EVO_FIELD(texture_small),
+                                             EVO_FIELD(texture_small_position), EVO_FIELD(texture_large),
+                                             EVO_FIELD(entry_requirements), EVO_FIELD(fame_per_star_earned),
+                                             EVO_FIELD(trophy_completed), EVO_FIELD(track), EVO_FIELD(time_of_day),
+                                             EVO_FIELD(speed_of_time), EVO_FIELD(weather), EVO_FIELD(precipitation),
+                                             EVO_FIELD(precipitation_time_scalar), EVO_FIELD(unk5),
+                                             EVO_FIELD(difficulty), EVO_FIELD(number_of_laps), EVO_FIELD(type),
+                                             EVO_FIELD(objectives), EVO_FIELD(extra_star_requirements),
+                                             EVO_FIELD(grid_modifier), EVO_FIELD(ai_grid_definitions),
+                                             EVO_FIELD(fame_earned_on_positions)};
+};
+
+template <>
+struct Fields<Collection> {
+    using T = Collection;
+    static constexpr auto value = std::tuple{EVO_FIELD(id), EVO_FIELD(name), EVO_FIELD(unk2), EVO_FIELD(unk3)};
+};
+
+template <>
+struct Fields<DcTour> {
+    using T = DcTour;
+    static constexpr auto value = std::tuple{EVO_FIELD(tourdata_str), EVO_FIELD(version), EVO_FIELD(tours),
+                                             EVO_FIELD(objectives), EVO_FIELD(faceoffs), EVO_FIELD(unlock_groups),
+                                             EVO_FIELD(drivers), EVO_FIELD(ghosts), EVO_FIELD(vehicle_classes),
+                                             EVO_FIELD(events), EVO_FIELD(collections)};
 };
 
 } // namespace Evo
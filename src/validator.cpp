@@ -0,0 +1,91 @@
+#include "common/parallel.h"
+#include "tour_index.h"
+#include "validator.h"
+
+namespace Evo {
+
+// Records that share their key with an earlier one. The index keeps the first, so any record it does not point back
+// to is a duplicate.
+template <typename T, auto key, typename Section>
+static void CheckDuplicates(const SectionIndex<T, key, Section>& index, const Array<T>& section, std::string_view name,
+                            std::string_view key_name, std::vector<std::string>& problems) {
+    for (size_t i = 0; i < section.data.size(); i++) {
+        const T* first = index.Find(IndexKey(section.data[i].*key));
+        if (first != &section.data[i]) {
+            problems.push_back(fmt::format("{}[{}]: duplicate {} {}, first used by {}[{}]", name, i, key_name,
+                                           IndexKey(section.data[i].*key), name, first - section.data.data()));
+        }
+    }
+}
+
+// Enough events per task to amortize the hand-off, few enough to balance across cores.
+static constexpr size_t EventsPerTask = 1024;
+
+std::vector<std::string> ValidateReferences(const DcTour& tour) {
+    std::vector<std::string> problems;
+    if (tour.version != 44) {
+        problems.push_back(fmt::format("version: unsupported version {}", tour.version.data));
+    }
+
+    const TourIndex index(tour);
+    CheckDuplicates(index.tours, tour.tours, "tours", "id", problems);
+    CheckDuplicates(index.objectives, tour.objectives, "objectives", "id", problems);
+    CheckDuplicates(index.faceoffs, tour.faceoffs, "faceoffs", "id", problems);
+    CheckDuplicates(index.unlock_groups, tour.unlock_groups, "unlock_groups", "id", problems);
+    CheckDuplicates(index.drivers, tour.drivers, "drivers", "id", problems);
+    CheckDuplicates(index.ghost_ids, tour.ghosts, "ghosts", "id", problems);
+    CheckDuplicates(index.ghosts, tour.ghosts, "ghosts", "name", problems);
+    CheckDuplicates(index.vehicle_classes, tour.vehicle_classes, "vehicle_classes", "id", problems);
+    CheckDuplicates(index.events, tour.events, "events", "event_id", problems);
+    CheckDuplicates(index.collections, tour.collections, "collections", "id", problems);
+
+    for (size_t i = 0; i < tour.unlock_groups.data.size(); i++) {
+        const UnlockGroup& group = tour.unlock_groups[i];
+        if (!index.tours.Contains(group.tour_id.data)) {
+            problems.push_back(fmt::format("unlock_groups[{}] (id {}): tour_id {} does not exist", i, group.id.data,
+                                           group.tour_id.data));
+        }
+    }
+    for (size_t i = 0; i < tour.faceoffs.data.size(); i++) {
+        const FaceOff& faceoff = tour.faceoffs[i];
+        if (!index.ghosts.Contains(faceoff.ghost.view())) {
+            problems.push_back(fmt::format("faceoffs[{}] (id {}): ghost \"{}\" does not exist", i, faceoff.id.data,
+                                           faceoff.ghost.view()));
+        }
+    }
+
+    // Events dominate large files, so they are checked in parallel. Each task reports into its own list and the
+    // lists are joined in order, which keeps the report identical to a sequential run.
+    const size_t event_count = tour.events.data.size();
+    std::vector<std::vector<std::string>> event_problems((event_count + EventsPerTask - 1) / EventsPerTask);
+    Common::ParallelFor(event_problems.size(), [&](size_t task, size_t) {
+        std::vector<std::string>& out = event_problems[task];
+        const size_t end = std::min(event_count, (task + 1) * EventsPerTask);
+        for (size_t i = task * EventsPerTask; i < end; i++) {
+            const Event& event = tour.events[i];
+            if (!index.unlock_groups.Contains(event.unlock_group.data)) {
+                out.push_back(fmt::format("events[{}] (event_id {}): unlock_group {} does not exist", i,
+                                          event.event_id.data, event.unlock_group.data));
+            }
+            const s32 player_slots = event.PlayerSlotCount();
+            if (player_slots != 1) {
+                out.push_back(fmt::format("events[{}] (event_id {}): {} player grid slots, expected exactly one", i,
+                                          event.event_id.data, player_slots));
+            }
+            for (size_t slot = 0; slot < event.ai_grid_definitions.data.size(); slot++) {
+                const s32 driver_id = event.ai_grid_definitions[slot].driver_id.data;
+                if (driver_id != -1 && !index.drivers.Contains(driver_id)) {
+                    out.push_back(fmt::format("events[{}] (event_id {}): ai_grid_definitions[{}] driver_id {} does "
+                                              "not exist",
+                                              i, event.event_id.data, slot, driver_id));
+                }
+            }
+        }
+    });
+    for (std::vector<std::string>& list : event_problems) {
+        problems.insert(problems.end(), std::make_move_iterator(list.begin()), std::make_move_iterator(list.end()));
+    }
+    return problems;
+}
+
+} // namespace Evo
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tours.h"
+
+namespace Evo {
+
+// Checks a loaded tour for problems the game would only hit at runtime: duplicate ids, references to unlock groups,
+// tours, drivers and ghosts that do not exist, and events without exactly one player grid slot. Returns every
+// problem found, in file order; an empty list means the tour is consistent.
+std::vector<std::string> ValidateReferences(const DcTour& tour);
+
+} // namespace Evo